@@ -21,9 +21,11 @@ __version__ = "0.1.0"
 
 __license__ = "MIT" 
 
+import asyncio
 import os
 import dataclasses
 from typing import (
+    Dict,
     Optional,
     Callable,
     Union,
@@ -43,6 +45,11 @@ from ctypes import (
     Array,
     c_uint64,
     c_uint32,
+    c_uint16,
+    c_uint8,
+    c_int32,
+    c_int64,
+    c_size_t,
     c_char,
     c_char_p,
     c_int,
@@ -50,6 +57,8 @@ from ctypes import (
     c_void_p,
     c_float,
     create_string_buffer,
+    CFUNCTYPE,
+    cast,
 )
 
 # Starting possition fen
@@ -127,6 +136,22 @@ H8: Square = 63
 
 # Max moves
 MAX_MOVES: int = 218
+MOVE_STR_SIZE: int = 6
+
+# Maximum search ply
+MAX_PLY: int = 100
+
+# Maximum number of PV lines searched
+MAX_MULTIPV: int = 16
+
+# Score of a mate at the root, a mate in n plies scores MATE - n
+MATE: int = 100000
+
+# Milliseconds lost per move to the GUI and OS
+DEFAULT_MOVE_OVERHEAD: int = 30
+
+# Default perft hash size in MB
+PERFT_HASH_MB: int = 16
 
 # Color number
 COLOR_NB: int = 2
@@ -187,32 +212,153 @@ class ChessBoard(Structure):
         ("ep", c_uint64),
         ("hash", c_uint64),
         ("pawn_hash", c_uint64),
+        ("checkers", c_uint64),
+        ("table", c_void_p),
+        ("pawn_table", c_void_p),
+        ("nnue", c_void_p),
     ]
 
 
 class Entry(Structure):
     """A C structure that represents a transposition table entry storing position evaluations and best moves."""
     _fields_ = [
-        ("key", c_uint64),
+        ("key", c_uint16),
+        ("move", c_uint16),
+        ("score", c_int32),
+        ("depth", c_uint8),
+        ("flag_age", c_uint8),
+        ("eval", c_uint16),
+    ]
+
+
+class Bucket(Structure):
+    """A C structure grouping the transposition table entries sharing one cache line."""
+    _fields_ = [("entry", Entry * 5), ("padding", c_uint32)]
+
+
+class Table(Structure):
+    """A C structure representing a transposition table with size, mask and array of cache-line buckets."""
+    _fields_ = [
+        ("size", c_size_t),
+        ("bucket", POINTER(Bucket)),
+        ("generation", c_int),
+        ("eval_version", c_int),
+    ]
+
+
+class Limits(Structure):
+    """A C structure with the search limits, zero fields are not limited."""
+    _fields_ = [
+        ("depth", c_int),
+        ("nodes", c_uint64),
+        ("mate", c_int),
+        ("movetime", c_int),
+    ]
+
+
+class TimeControl(Structure):
+    """A C structure holding the clock of both sides, in milliseconds."""
+    _fields_ = [
+        ("time", c_int * COLOR_NB),
+        ("inc", c_int * COLOR_NB),
+        ("movestogo", c_int),
+        ("overhead", c_int),
+    ]
+
+
+class TimeManager(Structure):
+    """A C structure with the soft and hard time limits of a running search."""
+    _fields_ = [
+        ("start", c_int64),
+        ("soft", c_int),
+        ("hard", c_int),
+        ("last", c_int),
+        ("stability", c_int),
+        ("iterations", c_int),
+        ("best", c_uint32),
+        ("score", c_int),
+        ("enabled", c_bool),
+        ("fixed", c_bool),
+    ]
+
+
+class PVLine(Structure):
+    """A C structure with one principal variation and its score."""
+    _fields_ = [
         ("score", c_int),
         ("depth", c_int),
-        ("flag", c_int),
+        ("pv_length", c_int),
+        ("pv", c_uint32 * MAX_PLY),
     ]
 
 
-class Table(Structure):
-    """A C structure representing a transposition table with size, mask and array of position entries."""
-    _fields_ = [("size", c_int), ("mask", c_int), ("entry", POINTER(Entry))]
+class SearchInfo(Structure):
+    """A C structure with the progress report of a search iteration."""
+    _fields_ = [
+        ("depth", c_int),
+        ("multipv", c_int),
+        ("seldepth", c_int),
+        ("score", c_int),
+        ("nodes", c_uint64),
+        ("nps", c_uint64),
+        ("time", c_int),
+        ("hashfull", c_int),
+        ("currmove", c_uint32),
+        ("currmovenumber", c_int),
+        ("pv_length", c_int),
+        ("pv", c_uint32 * MAX_PLY),
+    ]
+
+
+InfoCallback = CFUNCTYPE(None, POINTER(SearchInfo), c_void_p)
 
 
 class Search(Structure):
     """A C structure that manages chess engine search state including node count, stop flag, and transposition table."""
-    _fields_ = [("nodes", c_int), ("stop", c_bool), ("num", c_int), ("table", Table)]
+    _fields_ = [
+        ("nodes", c_uint64),
+        ("stop", c_bool),
+        ("ponder", c_bool),
+        ("num", c_int),
+        ("table", Table),
+        ("depth", c_int),
+        ("hash_mb", c_int),
+        ("job", c_void_p),
+        ("limits", Limits),
+        ("tc", TimeControl),
+        ("tm", TimeManager),
+        ("info", c_void_p),
+        ("info_data", c_void_p),
+        ("info_interval", c_int),
+        ("info_last", c_int),
+        ("multipv", c_int),
+        ("searchmoves_count", c_int),
+        ("searchmoves", c_uint32 * MAX_MOVES),
+        ("line_count", c_int),
+        ("lines", PVLine * MAX_MULTIPV),
+        ("eval_probes", c_uint64),
+        ("eval_hits", c_uint64),
+        ("tt_eval_hits", c_uint64),
+    ]
 
 
 class Undo(Structure):
     """A C structure that stores information needed to undo a chess move, including captured pieces, castling rights, and en passant state."""
-    _fields_ = [("capture", c_int), ("castle", c_int), ("ep", c_uint64)]
+    _fields_ = [
+        ("capture", c_int),
+        ("castle", c_int),
+        ("ep", c_uint64),
+        ("checkers", c_uint64),
+    ]
+
+
+class CheckInfo(Structure):
+    """A C structure with the squares and pieces that give check to the enemy king, computed once per position."""
+    _fields_ = [
+        ("squares", c_uint64 * 6),
+        ("blockers", c_uint64),
+        ("king", c_int),
+    ]
 
 
 try:
@@ -258,6 +404,15 @@ chess_lib.board_to_fen.argtypes = [POINTER(ChessBoard), POINTER(c_char)]
 chess_lib.board_to_fen.restype = c_void_p
 chess_lib.perft_test.argtypes = [POINTER(ChessBoard), c_int]
 chess_lib.perft_test.restype = c_uint64
+chess_lib.perft_parallel.argtypes = [POINTER(ChessBoard), c_int, c_int, c_int]
+chess_lib.perft_parallel.restype = c_uint64
+chess_lib.perft_divide.argtypes = [
+    POINTER(ChessBoard),
+    c_int,
+    POINTER(c_uint32),
+    POINTER(c_uint64),
+]
+chess_lib.perft_divide.restype = c_int
 chess_lib.board_clear.argtypes = [POINTER(ChessBoard)]
 chess_lib.board_clear.restype = c_void_p
 chess_lib.board_drawn_by_insufficient_material.argtypes = [POINTER(ChessBoard)]
@@ -286,13 +441,44 @@ chess_lib.illegal_to_move.argtypes = [POINTER(ChessBoard)]
 chess_lib.illegal_to_move.restype = c_int
 chess_lib.is_check.argtypes = [POINTER(ChessBoard)]
 chess_lib.is_check.restype = c_int
+chess_lib.is_pseudo_legal.argtypes = [POINTER(ChessBoard), c_uint32]
+chess_lib.is_pseudo_legal.restype = c_int
+chess_lib.is_legal.argtypes = [POINTER(ChessBoard), c_uint32]
+chess_lib.is_legal.restype = c_int
+chess_lib.check_info_init.argtypes = [POINTER(ChessBoard), POINTER(CheckInfo)]
+chess_lib.check_info_init.restype = None
+chess_lib.gives_check.argtypes = [POINTER(ChessBoard), POINTER(CheckInfo), c_uint32]
+chess_lib.gives_check.restype = c_int
+chess_lib.picker_moves.argtypes = [POINTER(ChessBoard), c_uint32, POINTER(c_uint32), POINTER(c_uint32)]
+chess_lib.picker_moves.restype = c_int
+
+chess_lib.eval.argtypes = [POINTER(ChessBoard)]
+chess_lib.eval.restype = c_int
+chess_lib.board_refresh_eval.argtypes = [POINTER(ChessBoard)]
+chess_lib.board_refresh_eval.restype = None
+chess_lib.nnue_load.argtypes = [c_char_p]
+chess_lib.nnue_load.restype = c_int
+chess_lib.nnue_set_enabled.argtypes = [c_bool]
+chess_lib.nnue_set_enabled.restype = c_int
+chess_lib.eval_searching.argtypes = []
+chess_lib.eval_searching.restype = c_bool
+chess_lib.nnue_stack_new.argtypes = []
+chess_lib.nnue_stack_new.restype = c_void_p
+chess_lib.nnue_stack_free.argtypes = [c_void_p]
+chess_lib.nnue_stack_free.restype = None
+chess_lib.nnue_enabled.argtypes = []
+chess_lib.nnue_enabled.restype = c_bool
+chess_lib.pesto_load.argtypes = [c_char_p]
+chess_lib.pesto_load.restype = c_int
+chess_lib.pesto_save.argtypes = [c_char_p]
+chess_lib.pesto_save.restype = c_int
 
 # Move Handling functions
 chess_lib.do_move.argtypes = [POINTER(ChessBoard), c_uint32, POINTER(Undo)]
 chess_lib.do_move.restype = c_void_p
 chess_lib.undo_move.argtypes = [POINTER(ChessBoard), c_uint32, POINTER(Undo)]
 chess_lib.undo_move.restype = c_void_p
-chess_lib.move_to_str.argtypes = [c_uint32]
+chess_lib.move_to_str.argtypes = [c_uint32, c_char_p]
 chess_lib.move_to_str.restype = c_char_p
 chess_lib.make_move.argtypes = [POINTER(ChessBoard), c_uint32]
 chess_lib.make_move.restype = c_void_p
@@ -304,12 +490,31 @@ chess_lib.thread_init.argtypes = [
     POINTER(c_uint32),
     c_float,
     c_bool,
+    c_int,
 ]
 chess_lib.thread_init.restype = c_void_p
 chess_lib.thread_stop.argtypes = [POINTER(Search)]
 chess_lib.thread_stop.restype = c_void_p
-chess_lib.best_move.argtypes = [POINTER(Search), POINTER(ChessBoard), POINTER(c_uint32)]
+chess_lib.search_start.argtypes = [POINTER(Search), POINTER(ChessBoard), c_bool, c_int]
+chess_lib.search_start.restype = c_int
+chess_lib.search_poll.argtypes = [POINTER(Search)]
+chess_lib.search_poll.restype = c_bool
+chess_lib.search_wait.argtypes = [POINTER(Search)]
+chess_lib.search_wait.restype = c_uint32
+chess_lib.search_ponderhit.argtypes = [POINTER(Search)]
+chess_lib.search_ponderhit.restype = None
+chess_lib.search_nodes.argtypes = [POINTER(Search)]
+chess_lib.search_nodes.restype = c_uint64
+chess_lib.best_move.argtypes = [POINTER(Search), POINTER(ChessBoard), POINTER(c_uint32), c_bool]
 chess_lib.best_move.restype = c_int
+chess_lib.search_clear.argtypes = [POINTER(Search)]
+chess_lib.search_clear.restype = c_void_p
+chess_lib.search_free.argtypes = [POINTER(Search)]
+chess_lib.search_free.restype = c_void_p
+chess_lib.search_set_hash.argtypes = [POINTER(Search), c_int]
+chess_lib.search_set_hash.restype = c_int
+chess_lib.search_hashfull.argtypes = [POINTER(Search)]
+chess_lib.search_hashfull.restype = c_int
 
 
 class IllegalMoveError(ValueError):
@@ -745,7 +950,8 @@ class Move:
             str: The move in SAN format
         """
         try:
-            result = chess_lib.move_to_str(hash(self))
+            buffer = create_string_buffer(MOVE_STR_SIZE)
+            result = chess_lib.move_to_str(hash(self), buffer)
             if not result:
                 return ""
             return str(result.decode("utf-8"))
@@ -980,71 +1186,288 @@ class SquareSet:
         return arr
 
 
+@dataclasses.dataclass
+class Info:
+    """Search progress reported by Searcher to its info callback.
+
+    Iteration reports have currmove None and carry the completed depth, score
+    and pv. Current move reports, sent at most every info interval, have
+    currmove set and carry the depth of the iteration in progress.
+    """
+
+    depth: int
+    multipv: int
+    seldepth: int
+    score: int
+    nodes: int
+    nps: int
+    time_ms: int
+    hashfull: int
+    currmove: Optional[Move]
+    currmovenumber: int
+    pv: List[Move]
+
+
+@dataclasses.dataclass
+class Line:
+    """One principal variation of a search, see Searcher.lines."""
+
+    score: int
+    depth: int
+    pv: List[Move]
+
+    @property
+    def move(self) -> Move:
+        """Root move of the line."""
+        return self.pv[0]
+
+
 class Searcher:
     """Chess engine searcher that manages search parameters and execution."""
 
-    def __init__(self, board: Board, debug: bool = False):
+    def __init__(self, board: Board, debug: bool = False, hash_mb: int = 16):
         """Initialize the searcher with a board position.
 
         Args:
             board: The chess board to analyze
             debug: Enable debug output during search
+            hash_mb: Transposition table size in megabytes
         """
         self.board = board
         self.search = Search()
+        self.search.hash_mb = hash_mb
         self.move = c_uint32()
         self.debug = debug
+        self.move_overhead = DEFAULT_MOVE_OVERHEAD
+        self.multipv = 1
+        self._info_callback: Optional[Any] = None
         self._is_searching = False
 
-    def start(self, depth: int = 6, time_s: float = 1.0) -> Move:
-        """Start the search for the best move.
+    def set_info_callback(
+        self, callback: Optional[Callable[[Info], None]], interval_ms: int = 1000
+    ) -> None:
+        """Receive search progress, called from the main search thread.
 
         Args:
-            depth: Maximum search depth (default 6 ply)
+            callback: Called with an Info after every completed iteration and
+                for current move reports, None to stop reporting
+            interval_ms: Minimum time between current move reports, 0 for none
+        """
+        if self._is_searching:
+            raise RuntimeError("Search already in progress")
 
-        Returns:
-            The best move found
+        def on_info(info_p: Any, _: Any) -> None:
+            info = info_p.contents
+            callback(
+                Info(
+                    depth=info.depth,
+                    multipv=info.multipv,
+                    seldepth=info.seldepth,
+                    score=info.score,
+                    nodes=int(info.nodes),
+                    nps=int(info.nps),
+                    time_ms=info.time,
+                    hashfull=info.hashfull,
+                    currmove=self._convert_move(info.currmove) if info.currmove else None,
+                    currmovenumber=info.currmovenumber,
+                    pv=[self._convert_move(m) for m in info.pv[: info.pv_length]],
+                )
+            )
+
+        # Keep the C function pointer alive as long as the search can call it
+        self._info_callback = InfoCallback(on_info) if callback else None
+        self.search.info = (
+            cast(self._info_callback, c_void_p).value if callback else None
+        )
+        self.search.info_interval = interval_ms if callback else 0
+
+    def set_hash(self, mb: int) -> None:
+        """Resize the transposition table, dropping its content.
 
         Raises:
-            ValueError: If depth is not positive
+            ValueError: If mb is not positive
+            MemoryError: If the table could not be allocated
         """
-        if depth <= 0:
-            raise ValueError("Search depth must be positive")
+        if mb <= 0:
+            raise ValueError("Hash size must be positive")
 
         if self._is_searching:
             raise RuntimeError("Search already in progress")
 
+        if not chess_lib.search_set_hash(byref(self.search), mb):
+            raise MemoryError(f"Could not allocate a {mb} MB hash table")
+
+    def go(
+        self,
+        depth: Optional[int] = None,
+        time_s: Optional[float] = 1.0,
+        threads: int = 1,
+        nodes: Optional[int] = None,
+        mate: Optional[int] = None,
+        wtime: int = 0,
+        btime: int = 0,
+        winc: int = 0,
+        binc: int = 0,
+        movestogo: int = 0,
+        ponder: bool = False,
+        searchmoves: Optional[List[Move]] = None,
+    ) -> None:
+        """Start the search in the background and return immediately.
+
+        Use poll() to check for completion and wait() to collect the move.
+        The search ends at the first limit reached. When the clock of the
+        side to move is given the time manager picks the thinking time and
+        time_s is ignored.
+
+        Args:
+            depth: Maximum search depth, None for no limit
+            time_s: Search time in seconds, None for no limit
+            threads: Number of Lazy SMP search threads sharing the hash table
+            nodes: Maximum nodes of the main thread, None for no limit. With a
+                single thread and a fresh Searcher the result is deterministic
+            mate: Search for a mate in this many moves
+            wtime, btime: Remaining clock of white and black in milliseconds
+            winc, binc: Increment per move of white and black in milliseconds
+            movestogo: Moves to the next time control, 0 for sudden death
+            ponder: Search on the opponent's time, the time limits only
+                apply after ponderhit()
+            searchmoves: Restrict the search to these root moves
+
+        The number of lines searched is set by the multipv attribute, see
+        lines for the result.
+
+        Raises:
+            ValueError: If a limit or threads is not positive
+            RuntimeError: If a search is running or could not be started
+        """
+        for name, value in (("depth", depth), ("nodes", nodes), ("mate", mate)):
+            if value is not None and value <= 0:
+                raise ValueError(f"Search {name} must be positive")
+
+        if time_s is not None and time_s <= 0:
+            raise ValueError("Search time must be positive")
+
+        if threads <= 0:
+            raise ValueError("Number of threads must be positive")
+
+        if self._is_searching:
+            raise RuntimeError("Search already in progress")
+
+        limits = self.search.limits
+        limits.depth = depth or 0
+        limits.nodes = nodes or 0
+        limits.mate = mate or 0
+        clock = btime if self.board.turn == BLACK else wtime
+        limits.movetime = int(time_s * 1000) if time_s and not clock else 0
+
+        tc = self.search.tc
+        tc.time[WHITE], tc.time[BLACK] = wtime, btime
+        tc.inc[WHITE], tc.inc[BLACK] = winc, binc
+        tc.movestogo = movestogo
+        tc.overhead = self.move_overhead
+        self.search.ponder = ponder
+
+        if not 1 <= self.multipv <= MAX_MULTIPV:
+            raise ValueError(f"MultiPV must be between 1 and {MAX_MULTIPV}")
+
+        searchmoves = searchmoves or []
+        self.search.multipv = self.multipv
+        self.search.searchmoves_count = len(searchmoves)
+        for i, move in enumerate(searchmoves):
+            self.search.searchmoves[i] = hash(move)
+
+        if not chess_lib.search_start(
+            byref(self.search), self.board.board.ptr, self.debug, threads
+        ):
+            raise RuntimeError("Could not start the search")
+
         self._is_searching = True
-        try:
-            # Initialize search thread
-            chess_lib.thread_init(
-                byref(self.search),
-                self.board.board.ptr,
-                byref(self.move),
-                time_s,
-                self.debug,
-            )
 
-            # Convert move value to Move object
-            best_move = self._convert_move(self.move.value)
+    def ponderhit(self) -> None:
+        """The expected move was played, continue the ponder search on the clock.
+
+        The search keeps its iterations and table, its clock starts now.
+        """
+        if self._is_searching:
+            chess_lib.search_ponderhit(byref(self.search))
+
+    def poll(self) -> bool:
+        """Return True once the search started by go() has ended."""
+        return bool(chess_lib.search_poll(byref(self.search)))
+
+    def wait(self) -> Move:
+        """Block until the search ends and return the best move."""
+        move = chess_lib.search_wait(byref(self.search))
+        self._is_searching = False
+        self.move = c_uint32(move)
+        return self._convert_move(move)
+
+    def start(
+        self,
+        depth: Optional[int] = None,
+        time_s: Optional[float] = 1.0,
+        threads: int = 1,
+        **limits: int,
+    ) -> Move:
+        """Search for the best move, blocking until the search ends.
+
+        The call returns as soon as the search finishes, which can be well
+        before time_s when a mate is found.
+
+        Args:
+            depth: Maximum search depth, None for no limit
+            time_s: Search time in seconds, None for no limit
+            threads: Number of Lazy SMP search threads sharing the hash table
+            limits: nodes, mate, wtime, btime, winc, binc, movestogo, ponder
+                and searchmoves, see go()
+
+        Returns:
+            The best move found
+
+        Raises:
+            ValueError: If a limit or threads is not positive
+        """
+        self.go(depth, time_s, threads, **limits)
+        return self.wait()
 
-            return best_move
+    async def start_async(
+        self,
+        depth: Optional[int] = None,
+        time_s: Optional[float] = 1.0,
+        threads: int = 1,
+        **limits: int,
+    ) -> Move:
+        """Asyncio counterpart of start(), the event loop keeps running.
 
-        finally:
-            self._is_searching = False
+        Cancelling the awaiting task stops the search.
+        """
+        self.go(depth, time_s, threads, **limits)
+        loop = asyncio.get_running_loop()
+        try:
+            return await loop.run_in_executor(None, self.wait)
+        except asyncio.CancelledError:
+            self.stop()
+            raise
 
     def stop(self) -> None:
-        """Stop the current search."""
+        """Stop the current search, wait() returns shortly after."""
         if self._is_searching:
-            # Stop the search
             chess_lib.thread_stop(byref(self.search))
-            self._is_searching = False
 
     def clear(self) -> None:
-        """Clear search state and hash tables."""
-        self.search = Search()
+        """Clear search state and hash tables.
+
+        The transposition table is kept between searches, so this is only
+        needed when starting a new game.
+        """
+        if self._is_searching:
+            raise RuntimeError("Search already in progress")
+
+        chess_lib.search_clear(byref(self.search))
         self.move = c_uint32()
-        self._is_searching = False
+
+    def __del__(self) -> None:
+        chess_lib.search_free(byref(self.search))
 
     def _convert_move(self, move_val: int) -> Move:
         """Convert raw move value to Move object."""
@@ -1062,9 +1485,100 @@ class Searcher:
 
     @property
     def nodes(self) -> int:
-        """Number of nodes searched."""
-        nodes = self.search.nodes
-        return int(nodes)
+        """Number of nodes searched, live while a search is running."""
+        return int(chess_lib.search_nodes(byref(self.search)))
+
+    @property
+    def hashfull(self) -> int:
+        """Permille of the transposition table used by the last search."""
+        return int(chess_lib.search_hashfull(byref(self.search)))
+
+    @staticmethod
+    def load_network(path: str) -> bool:
+        """Load an NNUE network file and evaluate with it from now on.
+
+        The network is shared by every Searcher, so it can only be replaced
+        while no search is running.
+
+        Returns:
+            bool: False if the file is missing or not a supported network
+
+        Raises:
+            RuntimeError: If any Searcher is searching
+        """
+        if chess_lib.eval_searching():
+            raise RuntimeError("Cannot load a network while a search is running")
+        return bool(chess_lib.nnue_load(path.encode()))
+
+    @staticmethod
+    def use_network(enabled: bool) -> None:
+        """Switch between the loaded network and the PESTO evaluation.
+
+        Static evaluations stored in the transposition tables are dropped by
+        the next search of each Searcher.
+
+        Raises:
+            RuntimeError: If any Searcher is searching
+        """
+        if not chess_lib.nnue_set_enabled(enabled):
+            raise RuntimeError("Cannot switch the evaluation while a search is running")
+
+    @staticmethod
+    def network_enabled() -> bool:
+        """True when the evaluation uses a network."""
+        return bool(chess_lib.nnue_enabled())
+
+    @staticmethod
+    def load_parameters(path: str) -> bool:
+        """Load PESTO weights from a parameter file, as written by the tuner.
+
+        Weights missing from the file keep their values. The weights are
+        shared by every Searcher, so they can only be replaced while no search
+        is running. Later searches and Board.eval() use the new weights, on
+        boards set up before the load as well.
+
+        Returns:
+            bool: False if the file is missing or malformed
+
+        Raises:
+            RuntimeError: If any Searcher is searching
+        """
+        if chess_lib.eval_searching():
+            raise RuntimeError("Cannot load parameters while a search is running")
+        return bool(chess_lib.pesto_load(path.encode()))
+
+    @staticmethod
+    def save_parameters(path: str) -> bool:
+        """Write the current PESTO weights as a parameter file."""
+        return bool(chess_lib.pesto_save(path.encode()))
+
+    @property
+    def eval_hit_rate(self) -> float:
+        """Share of static evaluations of the last search served by the eval
+        caches or the transposition table instead of eval()."""
+        probes = self.search.eval_probes
+        hits = self.search.eval_hits + self.search.tt_eval_hits
+        return hits / probes if probes else 0.0
+
+    @property
+    def depth(self) -> int:
+        """Depth completed by the main search thread."""
+        return int(self.search.depth)
+
+    @property
+    def lines(self) -> List[Line]:
+        """Lines of the last completed iteration, best first.
+
+        There are multipv lines unless the position has fewer legal moves.
+        """
+        return [
+            Line(
+                score=line.score,
+                depth=line.depth,
+                pv=[self._convert_move(m) for m in line.pv[: line.pv_length]],
+            )
+            for line in self.search.lines[: self.search.line_count]
+        ]
 
     @property
     def is_searching(self) -> bool:
@@ -1282,13 +1796,34 @@ class BaseBoard:
     def is_check(self) -> bool:
         return bool(chess_lib.is_check(self.ptr))
 
+    def gives_check(self, move: int) -> bool:
+        ci = CheckInfo()
+        chess_lib.check_info_init(self.ptr, byref(ci))
+        return bool(chess_lib.gives_check(self.ptr, byref(ci), move))
+
+    def eval(self) -> int:
+        # The material sums may come from weights loaded since
+        chess_lib.board_refresh_eval(self.ptr)
+        return chess_lib.eval(self.ptr)
+
     def illegal_to_move(self) -> bool:
         return bool(chess_lib.illegal_to_move(self.ptr))
 
-    def perft(self, depth: Optional[int] = 1) -> int:
-        nodes = chess_lib.perft_test(self.ptr, depth)
+    def perft(
+        self, depth: Optional[int] = 1, threads: int = 1, hash_mb: int = PERFT_HASH_MB
+    ) -> int:
+        nodes = chess_lib.perft_parallel(self.ptr, depth, threads, hash_mb)
         return int(nodes)
 
+    def perft_divide(self, depth: int) -> List[Tuple[Move, int]]:
+        moves: Array[Any] = utils.create_uint32_array(MAX_MOVES)
+        counts = (c_uint64 * MAX_MOVES)()
+        size: int = chess_lib.perft_divide(self.ptr, depth, moves, counts)
+        return [
+            (Move(*data), int(counts[i]))
+            for i, data in enumerate(utils.scan_move_list(moves[:size]))
+        ]
+
     def turn(self) -> Color:
         color = self.baseboard.color
         return Color(color)
@@ -1423,6 +1958,22 @@ class Board:
     def generate_legal_moves(self) -> Iterator[Move]:
         return self._generate_moves("gen_legal_moves")
 
+    def generate_picked_moves(
+        self, tt_move: Optional[Move] = None, killers: Tuple[Move, ...] = ()
+    ) -> Iterator[Move]:
+        """Moves in the order the search tries them.
+
+        Args:
+            tt_move: Move from the transposition table, dropped if not pseudo-legal
+            killers: Up to two killer moves of the current ply
+        """
+        array: Array[Any] = utils.create_uint32_array(MAX_MOVES)
+        slots = (c_uint32 * 2)(*[hash(move) for move in killers[:2]])
+        tt = hash(tt_move) if tt_move else 0
+        size: int = chess_lib.picker_moves(self.board.ptr, tt, slots, array)
+        for data in utils.scan_move_list(array[:size]):
+            yield Move(*data)
+
     @property
     def turn(self) -> Color:
         """Get the turn color '0' for WHITE, '1' for BLACK"""
@@ -1461,11 +2012,15 @@ class Board:
             raise ValueError("FEN cannot be empty")
         self.board.set_fen(fen)
 
-    def perft_test(self, depth: int = 1) -> BitBoard:
+    def perft_test(
+        self, depth: int = 1, threads: int = 1, hash_mb: int = PERFT_HASH_MB
+    ) -> BitBoard:
         """Calculate number of legal moves at given depth (performance test).
 
         Args:
             depth: Search depth (must be positive)
+            threads: Workers sharing the subtrees two plies below the root
+            hash_mb: Size of the hash shared by the workers, 0 for none
 
         Returns:
             BitBoard: Number of legal positions at given depth
@@ -1475,7 +2030,23 @@ class Board:
         """
         if depth <= 0:
             raise ValueError("Depth must be non-negative")
-        return self.board.perft(depth)
+        return self.board.perft(depth, threads, hash_mb)
+
+    def perft_divide(self, depth: int = 1) -> Dict[Move, int]:
+        """Perft of every legal move, the "divide" used to locate generator bugs.
+
+        Args:
+            depth: Search depth including the root move (must be positive)
+
+        Returns:
+            Dict[Move, int]: Leaf count below each root move, they sum to perft_test(depth)
+
+        Raises:
+            ValueError: If depth is not positive
+        """
+        if depth <= 0:
+            raise ValueError("Depth must be non-negative")
+        return dict(self.board.perft_divide(depth))
 
     def color_at(self, square: Square) -> Optional[Color]:
         """Get the color of the piece at given square.
@@ -1533,6 +2104,25 @@ class Board:
         """
         return self.board.is_check()
 
+    def gives_check(self, move: Move) -> bool:
+        """Check if a pseudo-legal move puts the opponent in check.
+
+        Args:
+            move: The move to test, it is not made on the board
+
+        Returns:
+            bool: True if the opponent's king is attacked after the move
+        """
+        return self.board.gives_check(hash(move))
+
+    def eval(self) -> int:
+        """Static evaluation of the position.
+
+        Returns:
+            int: Score in centipawns from the side to move's point of view
+        """
+        return self.board.eval()
+
     def illegal_to_move(self) -> bool:
         return self.board.illegal_to_move()
 
@@ -1770,9 +2360,7 @@ class PseudoLegalMoveGenerator:
         return self.board.generate_pseudo_legal_moves()
 
     def __contains__(self, move: Move) -> bool:
-        return move in set(
-            self
-        )  # TODO: add a function that check if a move is psaudo legal
+        return bool(chess_lib.is_pseudo_legal(self.board.board.ptr, hash(move)))
 
     def __repr__(self) -> str:
         sans = ", ".join(m.san for m in self)
@@ -1792,9 +2380,7 @@ class LegalMoveGenerator:
         return self.board.generate_legal_moves()
 
     def __contains__(self, move: Move) -> bool:
-        return move in set(
-            self
-        )  # TODO: add a function that check if a move is a legal move
+        return bool(chess_lib.is_legal(self.board.board.ptr, hash(move)))
 
     def __repr__(self) -> str:
         sans = ", ".join(m.san for m in self)
@@ -52,4 +52,62 @@ bb attacks_to_square(ChessBoard *board, int sq, bb occ) {
              (board->bb_squares[WHITE_QUEEN] | board->bb_squares[BLACK_QUEEN])) |
             (get_king_attacks(sq) &
              (board->bb_squares[WHITE_KING] | board->bb_squares[BLACK_KING])));
-}
\ No newline at end of file
+}
+
+bb board_checkers(ChessBoard *board) {
+    bb king = board->bb_squares[WHITE_KING + board->color];
+    if (!king)
+        return U64(0);
+
+    return attacks_to_square(board, get_lsb(king), board->occ[BOTH]) &
+           board->occ[!board->color];
+}
+
+bb slider_blockers(ChessBoard *board, int sq, int color) {
+    bb occ = board->occ[BOTH], blockers = 0;
+    bb snipers =
+        (get_rook_attacks(sq, 0) & (board->bb_squares[WHITE_ROOK + color] |
+                                    board->bb_squares[WHITE_QUEEN + color])) |
+        (get_bishop_attacks(sq, 0) & (board->bb_squares[WHITE_BISHOP + color] |
+                                      board->bb_squares[WHITE_QUEEN + color]));
+
+    while (snipers) {
+        int sniper;
+        POP_LSB(sniper, snipers);
+        bb between = BB_BETWEEN[sq][sniper] & occ;
+        if (between && !several(between))
+            blockers |= between;
+    }
+
+    return blockers;
+}
+
+bb board_pinned(ChessBoard *board) {
+    int color = board->color;
+    bb king = board->bb_squares[WHITE_KING + color];
+    if (!king)
+        return U64(0);
+
+    return slider_blockers(board, get_lsb(king), !color) & board->occ[color];
+}
+
+void check_info_init(ChessBoard *board, CheckInfo *ci) {
+    int color = board->color;
+    bb king = board->bb_squares[WHITE_KING + !color];
+    bb occ = board->occ[BOTH];
+
+    if (!king) {
+        *ci = (CheckInfo){.king = -1};
+        return;
+    }
+
+    int sq = get_lsb(king);
+    ci->king = sq;
+    ci->squares[PAWN] = get_pawns_attacks(sq, !color);
+    ci->squares[KNIGHT] = get_knight_attacks(sq);
+    ci->squares[BISHOP] = get_bishop_attacks(sq, occ);
+    ci->squares[ROOK] = get_rook_attacks(sq, occ);
+    ci->squares[QUEEN] = ci->squares[BISHOP] | ci->squares[ROOK];
+    ci->squares[KING] = 0;
+    ci->blockers = slider_blockers(board, sq, color) & board->occ[color];
+}
@@ -12,4 +12,16 @@ int attacks_to_king_square(ChessBoard *board, bb b_king);
 
 bb attacks_to_square(ChessBoard *board, int sq, bb occ);
 
+// Enemy pieces attacking the king of the side to move
+bb board_checkers(ChessBoard *board);
+
+// Own pieces pinned to the king of the side to move
+bb board_pinned(ChessBoard *board);
+
+// Pieces of both colors that are the only blocker between sq and a slider of color
+bb slider_blockers(ChessBoard *board, int sq, int color);
+
+// Direct check squares and discovered check blockers for the side to move
+void check_info_init(ChessBoard *board, CheckInfo *ci);
+
 #endif // ATTACKS_H
\ No newline at end of file
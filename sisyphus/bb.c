@@ -5,6 +5,11 @@ bb BB_KNIGHT[64];
 bb BB_BISHOP[64];
 bb BB_ROOK[64];
 bb BB_KING[64];
+bb BB_BETWEEN[64][64];
+bb BB_LINE[64][64];
+bb BB_ADJACENT_FILES[8];
+bb BB_FORWARD_FILE[2][64];
+bb BB_PASSED_SPAN[2][64];
 
 const bb MAGIC_BISHOP[64] = {
     0x010a0a1023020080L, 0x0050100083024000L, 0x8826083200800802L,
@@ -93,7 +98,7 @@ int popcount(bb bbit) {
 }
 
 int several(bb bbit) {
-    return bbit & (bbit - 1);
+    return (bbit & (bbit - 1)) != 0;
 }
 
 bool test_bit(bb bbit, const int sq) {
@@ -277,6 +282,38 @@ void bb_init() {
             BB_KING[square(rank, file)] = value;
         }
     }
+
+    // BB_BETWEEN and BB_LINE
+    for (int a = 0; a < 64; a++) {
+        for (int b = 0; b < 64; b++) {
+            BB_BETWEEN[a][b] = BB_LINE[a][b] = 0;
+            if (a == b)
+                continue;
+
+            if (bb_bishop(a, 0) & BIT(b)) {
+                BB_BETWEEN[a][b] = bb_bishop(a, BIT(b)) & bb_bishop(b, BIT(a));
+                BB_LINE[a][b] = (bb_bishop(a, 0) & bb_bishop(b, 0)) | BIT(a) | BIT(b);
+            } else if (bb_rook(a, 0) & BIT(b)) {
+                BB_BETWEEN[a][b] = bb_rook(a, BIT(b)) & bb_rook(b, BIT(a));
+                BB_LINE[a][b] = (bb_rook(a, 0) & bb_rook(b, 0)) | BIT(a) | BIT(b);
+            }
+        }
+    }
+
+    // Pawn structure spans
+    for (int f = 0; f < FILE_NB; f++) {
+        BB_ADJACENT_FILES[f] = (f > 0 ? FILE_A << (f - 1) : 0) |
+                               (f < FILE_NB - 1 ? FILE_A << (f + 1) : 0);
+    }
+    for (int sq = 0; sq < 64; sq++) {
+        bb file = FILE_A << file_of(sq);
+        bb above = rank_of(sq) < RANK_NB - 1 ? ~U64(0) << (8 * (rank_of(sq) + 1)) : 0;
+        bb below = rank_of(sq) > 0 ? ~U64(0) >> (8 * (RANK_NB - rank_of(sq))) : 0;
+        BB_FORWARD_FILE[WHITE][sq] = file & above;
+        BB_FORWARD_FILE[BLACK][sq] = file & below;
+        BB_PASSED_SPAN[WHITE][sq] = (file | BB_ADJACENT_FILES[file_of(sq)]) & above;
+        BB_PASSED_SPAN[BLACK][sq] = (file | BB_ADJACENT_FILES[file_of(sq)]) & below;
+    }
 }
 
 bb bb_bishop(int sq, bb obs) {
@@ -24,6 +24,17 @@ extern bb BB_BISHOP[64];
 extern bb BB_ROOK[64];
 extern bb BB_KING[64];
 
+// Squares strictly between two aligned squares, 0 if not aligned
+extern bb BB_BETWEEN[64][64];
+// Full line through two aligned squares, 0 if not aligned
+extern bb BB_LINE[64][64];
+// Files next to a file
+extern bb BB_ADJACENT_FILES[8];
+// Squares in front of a square on its file, from the color's point of view
+extern bb BB_FORWARD_FILE[2][64];
+// Squares in front of a square on its file and the adjacent files
+extern bb BB_PASSED_SPAN[2][64];
+
 // Initialize bitboard lookup tables
 void bb_init();
 
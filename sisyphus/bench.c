@@ -0,0 +1,232 @@
+// Fixed depth search over a built in position suite. With one thread the
+// total node count is deterministic and serves as a signature of the search,
+// any change to move ordering, pruning or evaluation changes it.
+//
+// The eval mode times each evaluation layer over the same positions, so the
+// cost of a new term shows up as evals/sec before it shows up as lost NPS.
+// Given a network it also times a full accumulator refresh (nnue) and the
+// incremental path of the search, one move made, evaluated and unmade
+// (nnue-inc).
+//
+// Usage: bench [depth] [threads] [hash_mb] [network]
+//        bench eval [evals] [network]
+
+#include "board.h"
+#include "nnue.h"
+#include "search.h"
+#include "timeman.h"
+#include <inttypes.h>
+
+#define BENCH_DEPTH 8
+#define BENCH_EVALS 2000000
+
+static const char *BENCH_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+    "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+    "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+    "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+    "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+    "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+    "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+    "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+    "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - - 0 1",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+    "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+    "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+    "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+    "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+    "5rk1/q6p/2p3bR/1pPp1rP1/1P1Pp3/P3B1Q1/1K3P2/R7 w - - 93 90",
+    "4rrk1/1p1nq3/p7/2p1P1pp/3P2bp/3Q1Bn1/PPPB4/1K2R1NR w - - 40 21",
+    "r3k2r/3nnpbp/q2pp1p1/p7/Pp1PPPP1/4BNN1/1P5P/R2Q1RK1 w kq - 0 16",
+    "3Qb1k1/1r2ppb1/pN1n2q1/Pp1Pp1Pr/4P2p/4BP2/4B1R1/1R5K b - - 11 40",
+    "4k3/3q1r2/1N2r1b1/3ppN2/2nPP3/1B1R2n1/2R1Q3/3K4 w - - 5 1",
+    "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+    "8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+    "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+    "8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+    "8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",
+    "8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+    "8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+    "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
+    "r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w - - 0 1",
+    "8/8/8/8/8/6k1/6p1/6K1 w - - 0 1",
+    "7k/7P/6K1/8/3B4/8/8/8 b - - 0 1",
+    "r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 4 4",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1"
+};
+
+#define BENCH_COUNT ((int)(sizeof(BENCH_FENS) / sizeof(BENCH_FENS[0])))
+
+static const char *EVAL_LAYERS[] = {"pesto", "pawns", "pieces", "eval", "nnue", "nnue-inc"};
+
+enum { LAYER_PESTO, LAYER_PAWNS, LAYER_PIECES, LAYER_EVAL, LAYER_NNUE, LAYER_NNUE_INC };
+
+static int eval_layer(ChessBoard *board, int layer, Move move) {
+    int mg = 0, eg = 0, value;
+    Undo undo;
+
+    switch (layer) {
+    case LAYER_PESTO:
+        return pesto_eval(board);
+    case LAYER_PAWNS:
+        evaluate_pawns(board, &mg, &eg);
+        break;
+    case LAYER_PIECES:
+        evaluate_pieces(board, &mg, &eg);
+        break;
+    case LAYER_EVAL:
+        return eval(board);
+    case LAYER_NNUE:
+        return nnue_eval(board);
+    default:
+        do_move(board, move, &undo);
+        value = nnue_eval(board);
+        undo_move(board, move, &undo);
+        return value;
+    }
+    return mg + eg;
+}
+
+// Pawns are timed without the cache, eval with it as in search
+static int bench_eval(int evals, bool network) {
+    static ChessBoard boards[BENCH_COUNT];
+    static Move moves[BENCH_COUNT];
+    static NNUEStack *stacks[BENCH_COUNT];
+    static PawnTable pawn_table;
+    int rounds = MAX(evals / BENCH_COUNT, 1);
+    int layers = network ? LAYER_NNUE_INC + 1 : LAYER_EVAL + 1;
+    volatile int sink = 0;
+
+    if (!pawn_table_alloc(&pawn_table, PAWN_TABLE_BITS))
+        return 1;
+
+    for (int i = 0; i < BENCH_COUNT; i++) {
+        Move legal[MAX_MOVES];
+        board_init(&boards[i]);
+        board_load_fen(&boards[i], BENCH_FENS[i]);
+        moves[i] = gen_legal_moves(&boards[i], legal) ? legal[0] : NULL_MOVE;
+        if (network && (stacks[i] = nnue_stack_new()) == NULL)
+            return 1;
+    }
+
+    // The classic layers are timed with the network switched off
+    nnue_set_enabled(false);
+
+    printf("%-8s %12s %10s %12s\n", "layer", "evals", "ms", "evals/sec");
+    for (int layer = 0; layer < layers; layer++) {
+        for (int i = 0; i < BENCH_COUNT; i++) {
+            boards[i].pawn_table = layer == LAYER_EVAL ? &pawn_table : NULL;
+            boards[i].nnue = layer == LAYER_NNUE_INC ? stacks[i] : NULL;
+            // Children update from the root accumulators, as in search
+            if (layer == LAYER_NNUE_INC)
+                nnue_eval(&boards[i]);
+        }
+        if (layer == LAYER_NNUE)
+            nnue_set_enabled(true);
+
+        int64_t start = time_now();
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < BENCH_COUNT; i++) {
+                // Positions without moves are timed on the refresh path
+                int timed = layer == LAYER_NNUE_INC && moves[i] == NULL_MOVE ? LAYER_NNUE : layer;
+                sink += eval_layer(&boards[i], timed, moves[i]);
+            }
+        }
+        int64_t elapsed = time_now() - start;
+
+        uint64_t count = (uint64_t)rounds * BENCH_COUNT;
+        printf("%-8s %12" PRIu64 " %10" PRId64 " %12" PRIu64 "\n", EVAL_LAYERS[layer],
+               count, elapsed, elapsed > 0 ? count * 1000 / (uint64_t)elapsed : count);
+    }
+
+    for (int i = 0; i < BENCH_COUNT; i++) {
+        boards[i].nnue = NULL;
+        nnue_stack_free(stacks[i]);
+    }
+    pawn_table_free(&pawn_table);
+    return sink == 0x7fffffff;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "eval") == 0) {
+        bb_init();
+        if (argc > 3 && !nnue_load(argv[3]))
+            return 1;
+        return bench_eval(argc > 2 ? atoi(argv[2]) : BENCH_EVALS, argc > 3);
+    }
+
+    int depth = argc > 1 ? atoi(argv[1]) : BENCH_DEPTH;
+    int threads = argc > 2 ? atoi(argv[2]) : 1;
+    int hash_mb = argc > 3 ? atoi(argv[3]) : DEFAULT_HASH_MB;
+    static Search search;
+    static ChessBoard board;
+    uint64_t nodes = 0, probes = 0, hits = 0, tt_hits = 0;
+
+    if (depth < 1 || threads < 1 || hash_mb < 1) {
+        fprintf(stderr, "usage: %s [depth] [threads] [hash_mb] [network]\n"
+                        "       %s eval [evals] [network]\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    if (argc > 4) {
+        if (!nnue_load(argv[4]))
+            return 1;
+        printf("Network %s (%s)\n", argv[4], nnue_simd());
+    }
+
+    bb_init();
+    board_init(&board);
+    search_set_hash(&search, hash_mb);
+
+    int64_t start = time_now();
+    for (int i = 0; i < BENCH_COUNT; i++) {
+        // Every position starts from an empty table so the count only
+        // depends on the position
+        board_load_fen(&board, BENCH_FENS[i]);
+        search_clear(&search);
+        search.limits = (Limits){.depth = depth};
+
+        if (!search_start(&search, &board, false, threads))
+            return 1;
+        search_wait(&search);
+
+        nodes += search.nodes;
+        probes += search.eval_probes;
+        hits += search.eval_hits;
+        tt_hits += search.tt_eval_hits;
+        printf("Position %2d/%d: %12" PRIu64 " %s\n", i + 1, BENCH_COUNT,
+               search.nodes, BENCH_FENS[i]);
+    }
+    int64_t elapsed = time_now() - start;
+
+    printf("\n===========================\n");
+    printf("Total time (ms) : %" PRId64 "\n", elapsed);
+    printf("Nodes searched  : %" PRIu64 "\n", nodes);
+    printf("Nodes/second    : %" PRIu64 "\n",
+           elapsed > 0 ? nodes * 1000 / (uint64_t)elapsed : nodes);
+    printf("Eval probes     : %" PRIu64 "\n", probes);
+    printf("Eval cache hits : %.1f%% (TT %.1f%%)\n",
+           probes ? 100.0 * (hits + tt_hits) / probes : 0.0,
+           probes ? 100.0 * tt_hits / probes : 0.0);
+
+    search_free(&search);
+    return 0;
+}
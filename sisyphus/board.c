@@ -1,16 +1,15 @@
-#define _POSIX_C_SOURCE 199309L
+#define _POSIX_C_SOURCE 200809L
 
 #include "board.h"
+#include "attacks.h"
+#include "eval.h"
 #include "time.h"
 #include "utils.h"
 #include <ctype.h>
+#include <pthread.h>
 #include <string.h>
 
 #define DURATION 1
-#define SIZE (1 << 20)
-#define MASK ((SIZE) - 1)
-
-Entry_t TABLE[SIZE] = {0};
 
 static const char *PIECE_SYMBOLS[13] = {
     [WHITE_PAWN] = "♟ ", [WHITE_KNIGHT] = "♞ ", [WHITE_BISHOP] = "♝ ",
@@ -24,57 +23,256 @@ static const char *PIECE_SYMBOLS[13] = {
 
 const char *PIECE_LABEL[COLOR_NB] = {"PNBRQK", "pnbrqk"};
 
+struct SearchJob {
+    pthread_mutex_t lock;   // Protects finished and done
+    pthread_cond_t cond;    // Signaled when finished or done change
+    bool finished;          // Main thread has returned
+    bool done;              // Helpers joined and result collected
+    pthread_t controller;   // Enforces the time limit and collects results
+    threadpool pool;        // Search threads
+    Thread_d *threads;      // Per thread search data
+    int count;              // Number of search threads
+    bool timed;             // False when only stop or the limits end the search
+    struct timespec deadline; // Absolute time at which the search is stopped
+};
+
+static void search_job_signal(SearchJob *job, bool *flag) {
+    pthread_mutex_lock(&job->lock);
+    *flag = true;
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+}
+
 void *thread_start(void *arg) {
     Thread_d *thread_d = (Thread_d *)arg;
 
-    thread_d->score =
-        best_move(thread_d->search, thread_d->board, thread_d->move, thread_d->debug);
+    thread_d->score = iterative_deepening(thread_d);
+
+    // Helpers only exist to feed the shared table, once the main thread is
+    // done there is nothing left for them to do.
+    if (thread_d->id == 0) {
+        thread_stop(thread_d->search);
+        search_job_signal(thread_d->search->job, &thread_d->search->job->finished);
+    }
 
     return NULL;
 }
 
+static void *search_controller(void *arg) {
+    Search *search = (Search *)arg;
+    SearchJob *job = search->job;
+
+    // Sleep until the main thread returns or the time is up, whichever
+    // happens first, so early mates don't cost the full duration.
+    pthread_mutex_lock(&job->lock);
+    while (!job->finished) {
+        if (!job->timed)
+            pthread_cond_wait(&job->cond, &job->lock);
+        else if (pthread_cond_timedwait(&job->cond, &job->lock, &job->deadline) != 0)
+            break;
+    }
+    pthread_mutex_unlock(&job->lock);
+
+    thread_stop(search);
+    thpool_wait(job->pool);
+    thpool_destroy(job->pool);
+
+    search->move = job->threads[0].move;
+    search->nodes = 0;
+    for (int i = 0; i < job->count; i++) {
+        search->nodes += job->threads[i].nodes;
+    }
+    search_eval_stats(search, job->threads, job->count);
+
+    search_job_signal(job, &job->done);
+    return NULL;
+}
+
+static void search_job_set_deadline(Search *search, SearchJob *job) {
+    job->timed = search->tm.enabled;
+
+    if (job->timed) {
+        clock_gettime(CLOCK_REALTIME, &job->deadline);
+        job->deadline.tv_sec += search->tm.hard / 1000;
+        job->deadline.tv_nsec += (long)(search->tm.hard % 1000) * 1000000L;
+        if (job->deadline.tv_nsec >= 1000000000L) {
+            job->deadline.tv_sec++;
+            job->deadline.tv_nsec -= 1000000000L;
+        }
+    }
+}
+
+static void search_job_free(SearchJob *job) {
+    pthread_mutex_destroy(&job->lock);
+    pthread_cond_destroy(&job->cond);
+    for (int i = 0; i < job->count; i++)
+        thread_caches_free(&job->threads[i]);
+    free(job->threads);
+    free(job);
+}
+
 void thread_stop(Search *search) {
     search->stop = true;
 }
 
-void thread_init(Search *search, ChessBoard *board, Move *result, 
-                float duration, 
-                bool debug) {
-    Thread_d *thread_d = (Thread_d *)calloc(1, sizeof(Thread_d));
+int search_start(Search *search, ChessBoard *board, bool debug, int threads) {
+    if (search->job != NULL) {
+        err("search_start(): A search is already running");
+        return 0;
+    }
 
-    if (thread_d == NULL) {
-        err("thread_init(): Could not allocate memory for thread_d");
+    threads = MAX(threads, 1);
+    SearchJob *job = (SearchJob *)calloc(1, sizeof(SearchJob));
+
+    if (job == NULL) {
+        err("search_start(): Could not allocate memory for the search job");
+        return 0;
     }
 
-    thread_d->board = board;
-    thread_d->search = search;
-    thread_d->move = result;
-    thread_d->score = -INF;
-    thread_d->debug = debug;
+    job->count = threads;
+    job->threads = (Thread_d *)calloc(threads, sizeof(Thread_d));
 
-    threadpool thpool_p;
-    thpool_p = thpool_init(1);
+    if (job->threads == NULL) {
+        err("search_start(): Could not allocate memory for thread_d");
+        free(job);
+        return 0;
+    }
 
-    if (thpool_p == NULL) {
-        free(thread_d);
+    if (!search_init(search)) {
+        free(job->threads);
+        free(job);
+        return 0;
     }
 
-    if (thpool_add_work(thpool_p, (void *)thread_start, (void *)thread_d) == -1) {
-        free(thread_d);
-        thpool_destroy(thpool_p);
+    for (int i = 0; i < threads; i++) {
+        job->threads[i].id = i;
+        job->threads[i].search = search;
+        job->threads[i].score = -INF;
+        job->threads[i].debug = debug && i == 0;
+        memcpy(&job->threads[i].board, board, sizeof(ChessBoard));
+        job->threads[i].board.table = &search->table;
+
+        if (!thread_caches_alloc(&job->threads[i])) {
+            for (int j = 0; j < i; j++)
+                thread_caches_free(&job->threads[j]);
+            free(job->threads);
+            free(job);
+            return 0;
+        }
     }
 
-    struct timespec ts;
-    ts.tv_sec = (time_t)duration;
-    ts.tv_nsec = (long)((duration - (time_t)duration) * 1000000000L);
-    nanosleep(&ts, NULL);
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->cond, NULL);
 
-    thread_stop(search);
-    thpool_destroy(thpool_p);
-    free(thread_d);
+    // The main thread polls the hard limit, the deadline is only a backstop
+    time_init(&search->tm, &search->tc, &search->limits, board->color);
+    if (!search->ponder)
+        search_job_set_deadline(search, job);
+
+    job->pool = thpool_init(threads);
+
+    if (job->pool == NULL) {
+        search_job_free(job);
+        return 0;
+    }
+
+    search->move = NULL_MOVE;
+    search->job = job;
+
+    for (int i = 0; i < threads; i++) {
+        if (thpool_add_work(job->pool, (void *)thread_start, (void *)&job->threads[i]) == -1) {
+            err("search_start(): Could not add search thread to the pool");
+            thread_stop(search);
+            // The main thread never runs, don't wait for it
+            if (i == 0)
+                job->finished = true;
+            break;
+        }
+    }
+
+    if (pthread_create(&job->controller, NULL, search_controller, search) != 0) {
+        err("search_start(): Could not create the controller thread");
+        thread_stop(search);
+        thpool_wait(job->pool);
+        thpool_destroy(job->pool);
+        search_job_free(job);
+        search->job = NULL;
+        return 0;
+    }
+
+    return 1;
 }
 
-void init_table() {
+bool search_poll(Search *search) {
+    SearchJob *job = search->job;
+
+    if (job == NULL)
+        return true;
+
+    pthread_mutex_lock(&job->lock);
+    bool done = job->done;
+    pthread_mutex_unlock(&job->lock);
+
+    return done;
+}
+
+void search_ponderhit(Search *search) {
+    SearchJob *job = search->job;
+
+    if (job == NULL || !search->ponder)
+        return;
+
+    // The clock given with go ponder starts running now, the iterations and
+    // the table built so far are kept
+    pthread_mutex_lock(&job->lock);
+    search->tm.start = time_now();
+    search->tm.last = 0;
+    search_job_set_deadline(search, job);
+    search->ponder = false;
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+}
+
+uint64_t search_nodes(Search *search) {
+    SearchJob *job = search->job;
+    uint64_t nodes = 0;
+
+    if (job == NULL || search_poll(search))
+        return search->nodes;
+
+    for (int i = 0; i < job->count; i++) {
+        nodes += job->threads[i].nodes;
+    }
+
+    return nodes;
+}
+
+Move search_wait(Search *search) {
+    SearchJob *job = search->job;
+
+    if (job == NULL)
+        return search->move;
+
+    pthread_join(job->controller, NULL);
+    search_job_free(job);
+    search->job = NULL;
+
+    return search->move;
+}
+
+void thread_init(Search *search, ChessBoard *board, Move *result, 
+                float duration, 
+                bool debug,
+                int threads) {
+    search->limits.movetime = (int)(duration * 1000);
+
+    if (!search_start(search, board, debug, threads))
+        return;
+
+    *result = search_wait(search);
+}
+
+void init_table(void) {
     int pc, p, sq;
     for (p = PAWN, pc = WHITE_PAWN; p <= KING; pc += 2, p++) {
         for (sq = 0; sq < 64; sq++) {
@@ -94,10 +292,6 @@ void board_clear(ChessBoard *board) {
     }
 
     board->castle = CASTLE_ALL;
-    castling_rights[0] = CASTLE_WHITE_QUEEN_SIDE;
-    castling_rights[7] = CASTLE_WHITE_KING_SIDE;
-    castling_rights[56] = CASTLE_BLACK_QUEEN_SIDE;
-    castling_rights[63] = CASTLE_BLACK_KING_SIDE;
 
     board->hash = U64(0);
     board->pawn_hash = U64(0);
@@ -121,6 +315,8 @@ void board_update(ChessBoard *board, int sq, int piece) {
             CLEAR_BIT(board->occ[WHITE], sq);
         }
         board->hash ^= HASH_PIECES[prev][sq];
+        if (PAWN_HASHED(prev))
+            board->pawn_hash ^= HASH_PIECES[prev][sq];
         board->mg[COLOR(prev)] -= mg_table[prev][sq];
         board->eg[COLOR(prev)] -= eg_table[prev][sq];
         board->gamePhase -= gamephaseInc[prev];
@@ -135,12 +331,27 @@ void board_update(ChessBoard *board, int sq, int piece) {
             SET_BIT(board->occ[WHITE], sq);
         }
         board->hash ^= HASH_PIECES[piece][sq];
+        if (PAWN_HASHED(piece))
+            board->pawn_hash ^= HASH_PIECES[piece][sq];
         board->mg[COLOR(piece)] += mg_table[piece][sq];
         board->eg[COLOR(piece)] += eg_table[piece][sq];
         board->gamePhase += gamephaseInc[piece];
     }
 }
 
+void board_refresh_eval(ChessBoard *board) {
+    board->mg[WHITE] = board->mg[BLACK] = 0;
+    board->eg[WHITE] = board->eg[BLACK] = 0;
+
+    for (int sq = 0; sq < SQUARE_NB; sq++) {
+        int piece = board->squares[sq];
+        if (piece == NONE)
+            continue;
+        board->mg[COLOR(piece)] += mg_table[piece][sq];
+        board->eg[COLOR(piece)] += eg_table[piece][sq];
+    }
+}
+
 void board_init(ChessBoard *board) {
     if (board == NULL)
         return;
@@ -170,6 +381,7 @@ void board_init(ChessBoard *board) {
     board->pawn_hash = U64(0);
     gen_curr_state_zobrist(board);
     gen_pawn_zobrist(board);
+    board->checkers = board_checkers(board);
 }
 
 void print_board(ChessBoard *board) {
@@ -340,6 +552,7 @@ void board_load_fen(ChessBoard *board, const char *fen) {
     board->pawn_hash = U64(0);
     gen_curr_state_zobrist(board);
     gen_pawn_zobrist(board);
+    board->checkers = board_checkers(board);
 
     free(str);
 }
@@ -389,37 +602,213 @@ void board_to_fen(ChessBoard *board, char *fen) {
     sprintf(fen, " %s", str);
 }
 
-bb perft_test(ChessBoard *board, int depth) {
+// Entries are two words written without a lock, the key is stored xored with
+// the data so a torn write from another worker fails the check on probe
+INLINE bool perft_probe(PerftTable *table, bb hash, int depth, bb *nodes) {
+    Entry_t *entry = &table->entries[hash & table->mask];
+    bb key = entry->key, data = entry->data;
+
+    if ((key ^ data) != hash || (int)(data & 0xff) != depth)
+        return false;
+
+    *nodes = data >> 8;
+    return true;
+}
+
+INLINE void perft_store(PerftTable *table, bb hash, int depth, bb nodes) {
+    Entry_t *entry = &table->entries[hash & table->mask];
+    bb data = (nodes << 8) | (bb)depth;
+
+    entry->key = hash ^ data;
+    entry->data = data;
+}
+
+static bb perft(ChessBoard *board, PerftTable *table, int depth) {
     Undo undo;
     Move moves[MAX_MOVES];
     bb nodes = U64(0);
     int count = 0;
-    depth = MAX(depth, 0);
 
     if (!depth)
         return U64(1);
 
-    Entry_t *entry = &TABLE[(board->hash & MASK)];
+    // Bulk counting, the leaves are never made
+    if (depth == 1)
+        return gen_legal_moves(board, moves);
 
-    if (entry->key == board->hash && entry->depth == depth) {
-        return entry->value;
-    }
-    count = gen_moves(board, moves);
+    if (table && perft_probe(table, board->hash, depth, &nodes))
+        return nodes;
+
+    count = gen_legal_moves(board, moves);
     for (count -= 1; count >= 0; count--) {
         Move move = moves[count];
         do_move(board, move, &undo);
-        if (!illegal_to_move(board))
-            nodes += perft_test(board, depth - 1);
+        nodes += perft(board, table, depth - 1);
         undo_move(board, move, &undo);
     }
 
-    entry->depth = depth;
-    entry->key = board->hash;
-    entry->value = nodes;
+    if (table)
+        perft_store(table, board->hash, depth, nodes);
 
     return nodes;
 }
 
+// The largest power of two number of entries that fits in hash_mb, no table
+// for 0
+static PerftTable *perft_table_new(int hash_mb) {
+    if (hash_mb <= 0)
+        return NULL;
+
+    PerftTable *table = malloc(sizeof(PerftTable));
+    size_t count = 1;
+
+    while (count * 2 * sizeof(Entry_t) <= (size_t)hash_mb << 20)
+        count *= 2;
+
+    if (table == NULL || (table->entries = calloc(count, sizeof(Entry_t))) == NULL) {
+        err("perft: Could not allocate memory for the perft table");
+        free(table);
+        return NULL;
+    }
+    table->mask = count - 1;
+
+    return table;
+}
+
+static void perft_table_free(PerftTable *table) {
+    if (table == NULL)
+        return;
+
+    free(table->entries);
+    free(table);
+}
+
+// A subtree searched by one worker, the root moves lead to it
+typedef struct {
+    ChessBoard *root;
+    PerftTable *table;
+    Move moves[2];
+    int count;
+    int depth;
+    bool failed; // No board for the worker, the caller runs the job
+    bb nodes;
+} PerftJob;
+
+static void perft_worker(PerftJob *job) {
+    ChessBoard *board = malloc(sizeof(ChessBoard));
+    Undo undo;
+
+    if (board == NULL) {
+        err("perft: Could not allocate memory for the worker board");
+        job->failed = true;
+        job->nodes = U64(0);
+        return;
+    }
+
+    *board = *job->root;
+    for (int i = 0; i < job->count; i++)
+        do_move(board, job->moves[i], &undo);
+
+    job->nodes = perft(board, job->table, job->depth);
+    free(board);
+}
+
+bb perft_parallel(ChessBoard *board, int depth, int threads, int hash_mb) {
+    Move moves[MAX_MOVES], replies[MAX_MOVES];
+    Undo undo;
+    bb nodes = U64(0);
+
+    depth = MAX(depth, 0);
+    threads = MAX(threads, 1);
+
+    PerftTable *table = perft_table_new(hash_mb);
+
+    if (threads == 1 || depth < 3) {
+        nodes = perft(board, table, depth);
+        perft_table_free(table);
+        return nodes;
+    }
+
+    // Split two plies below the root, root move counts are too uneven to
+    // keep every worker busy
+    int count = gen_legal_moves(board, moves), jobs = 0;
+    PerftJob *job = malloc(sizeof(PerftJob) * MAX_MOVES * MAX_MOVES);
+    threadpool pool = job ? thpool_init(threads) : NULL;
+
+    if (job == NULL || pool == NULL) {
+        err("perft: Could not start the perft workers, running single threaded");
+        free(job);
+        nodes = perft(board, table, depth);
+        perft_table_free(table);
+        return nodes;
+    }
+
+    for (int i = 0; i < count; i++) {
+        do_move(board, moves[i], &undo);
+        int size = gen_legal_moves(board, replies);
+        for (int j = 0; j < size; j++) {
+            job[jobs++] = (PerftJob) {
+                .root = board,
+                .table = table,
+                .moves = {moves[i], replies[j]},
+                .count = 2,
+                .depth = depth - 2,
+                .failed = false,
+            };
+        }
+        undo_move(board, moves[i], &undo);
+    }
+
+    for (int i = 0; i < jobs; i++) {
+        if (thpool_add_work(pool, (void *)perft_worker, (void *)&job[i]) == -1)
+            job[i].failed = true;
+    }
+    thpool_wait(pool);
+    thpool_destroy(pool);
+
+    for (int i = 0; i < jobs; i++) {
+        // Jobs the pool or a worker could not take run here on the root board
+        if (job[i].failed) {
+            Undo replyUndo;
+            do_move(board, job[i].moves[0], &undo);
+            do_move(board, job[i].moves[1], &replyUndo);
+            job[i].nodes = perft(board, table, job[i].depth);
+            undo_move(board, job[i].moves[1], &replyUndo);
+            undo_move(board, job[i].moves[0], &undo);
+        }
+        nodes += job[i].nodes;
+    }
+
+    free(job);
+    perft_table_free(table);
+
+    return nodes;
+}
+
+bb perft_test(ChessBoard *board, int depth) {
+    // Each call owns its table so concurrent perfts don't share entries
+    return perft_parallel(board, depth, 1, PERFT_HASH_MB);
+}
+
+int perft_divide(ChessBoard *board, int depth, Move *moves, bb *counts) {
+    Undo undo;
+
+    if (depth <= 0)
+        return 0;
+
+    int count = gen_legal_moves(board, moves);
+    PerftTable *table = perft_table_new(PERFT_HASH_MB);
+
+    for (int i = 0; i < count; i++) {
+        do_move(board, moves[i], &undo);
+        counts[i] = perft(board, table, depth - 1);
+        undo_move(board, moves[i], &undo);
+    }
+    perft_table_free(table);
+
+    return count;
+}
+
 const int pawn_square_values[64] = {
     0,  0,  0,   0,  0,  0,   0,  0,  5,  10, 10, -20, -20, 10, 10, 5,
     5,  -5, -10, 0,  0,  -10, -5, 5,  0,  0,  0,  20,  20,  0,  0,  0,
@@ -575,7 +964,10 @@ const int *square_values[13] = {
 
 };
 
-int castling_rights[64] = {0};
+const int castling_rights[64] = {
+    [0] = CASTLE_WHITE_QUEEN_SIDE, [7] = CASTLE_WHITE_KING_SIDE,
+    [56] = CASTLE_BLACK_QUEEN_SIDE, [63] = CASTLE_BLACK_KING_SIDE,
+};
 
 int *mg_pesto_table[6] = {mg_pawn_table, mg_knight_table, mg_bishop_table,
                           mg_rook_table, mg_queen_table,  mg_king_table
@@ -587,4 +979,86 @@ int *eg_pesto_table[6] = {eg_pawn_table, eg_knight_table, eg_bishop_table,
 
 int gamephaseInc[12] = {0, 0, 1, 1, 1, 1, 2, 2, 4, 4, 0, 0};
 int mg_table[12][64];
-int eg_table[12][64];
\ No newline at end of file
+int eg_table[12][64];
+const PestoParam PESTO_PARAMS[PESTO_PARAM_COUNT] = {
+    {"mg_value", mg_value, 6},            {"eg_value", eg_value, 6},
+    {"mg_pawn_table", mg_pawn_table, 64}, {"eg_pawn_table", eg_pawn_table, 64},
+    {"mg_knight_table", mg_knight_table, 64}, {"eg_knight_table", eg_knight_table, 64},
+    {"mg_bishop_table", mg_bishop_table, 64}, {"eg_bishop_table", eg_bishop_table, 64},
+    {"mg_rook_table", mg_rook_table, 64}, {"eg_rook_table", eg_rook_table, 64},
+    {"mg_queen_table", mg_queen_table, 64}, {"eg_queen_table", eg_queen_table, 64},
+    {"mg_king_table", mg_king_table, 64}, {"eg_king_table", eg_king_table, 64},
+};
+
+int pesto_load(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        err("pesto_load(): could not open the parameter file");
+        return 0;
+    }
+
+    // Read everything first, a bad file leaves the weights untouched
+    int values[PESTO_PARAM_COUNT][64];
+    bool seen[PESTO_PARAM_COUNT] = {false};
+    char name[64];
+    int ok = 1;
+
+    while (ok && fscanf(file, " %63s", name) == 1) {
+        if (name[0] == '#') {
+            fscanf(file, "%*[^\n]");
+            continue;
+        }
+
+        int i = 0;
+        while (i < PESTO_PARAM_COUNT && strcmp(name, PESTO_PARAMS[i].name) != 0)
+            i++;
+        if (i == PESTO_PARAM_COUNT) {
+            ok = 0;
+            break;
+        }
+
+        for (int j = 0; j < PESTO_PARAMS[i].count && ok; j++)
+            ok = fscanf(file, "%d", &values[i][j]) == 1;
+        seen[i] = true;
+    }
+    fclose(file);
+
+    if (!ok) {
+        err("pesto_load(): malformed parameter file");
+        return 0;
+    }
+
+    // Searches read the combined tables without locking
+    if (!eval_lock_idle()) {
+        err("pesto_load(): a search is running");
+        return 0;
+    }
+    for (int i = 0; i < PESTO_PARAM_COUNT; i++) {
+        if (seen[i])
+            memcpy(PESTO_PARAMS[i].values, values[i], PESTO_PARAMS[i].count * sizeof(int));
+    }
+    init_table();
+    eval_unlock(true);
+    return 1;
+}
+
+int pesto_save(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        err("pesto_save(): could not create the parameter file");
+        return 0;
+    }
+
+    fprintf(file, "# PESTO weights, tables from a8 to h1 as in board.c\n");
+    for (int i = 0; i < PESTO_PARAM_COUNT; i++) {
+        fprintf(file, "%s", PESTO_PARAMS[i].name);
+        for (int j = 0; j < PESTO_PARAMS[i].count; j++)
+            fprintf(file, "%s%d", j % 8 == 0 && PESTO_PARAMS[i].count > 8 ? "\n   " : " ",
+                    PESTO_PARAMS[i].values[j]);
+        fprintf(file, "\n");
+    }
+
+    int ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
@@ -44,10 +44,19 @@ extern int eg_table[12][64];
 // Game phase weights for each piece
 extern int gamephaseInc[12];
 
+// Tunable PESTO weights, by the name used in parameter files
+#define PESTO_PARAM_COUNT 14
+typedef struct {
+    const char *name;
+    int *values;
+    int count;
+} PestoParam;
+extern const PestoParam PESTO_PARAMS[PESTO_PARAM_COUNT];
+
 // Lookup tables for piece values and castling
 extern const int *square_values[13];
 extern int piece_material[13];
-extern int castling_rights[64];
+extern const int castling_rights[64];
 
  /* Macros */
 #define MAX(x, y) (x ^ ((x ^ y) & -(x < y)))     // Get maximum of two values
@@ -57,6 +66,7 @@ extern int castling_rights[64];
 #define PIECE(x) (((x) & ~1) >> 1)               // Get piece type from piece code
 #define COLOR(x) ((x) & 1)                        // Get piece color
 #define SWITCH_SIDE(x) (x->color ^= BLACK)        // Switch side to move
+#define PERFT_HASH_MB 16                          // Default perft hash size
 
 // Board manipulation functions
 void board_init(ChessBoard *b);                   // Initialize chess board
@@ -64,6 +74,12 @@ void print_board(ChessBoard *b);                  // Print board representation
 void board_load_fen(ChessBoard *board, const char *fen);  // Load position from FEN
 void board_to_fen(ChessBoard *board, char *fen);  // Convert position to FEN
 void board_update(ChessBoard *board, int sq, int piece);  // Update board state
+void board_refresh_eval(ChessBoard *board);       // Recompute the material and PESTO sums from the pieces
+void init_table(void);                            // Combine material and PESTO tables into mg_table/eg_table
+
+// PESTO parameter files, loading applies to boards set up afterwards
+int pesto_load(const char *path);                 // Replace the weights named in a parameter file, fails while a search runs
+int pesto_save(const char *path);                 // Write all weights as a parameter file
 
 // Game state evaluation
 int board_drawn_by_insufficient_material(ChessBoard *board);  // Check material draw
@@ -71,7 +87,14 @@ int is_draw(ChessBoard *board, int ply);          // Check if position is drawn
 
 // Testing and threading
 bb perft_test(ChessBoard *board, int depth);      // Performance test
-void thread_init(Search *search, ChessBoard *board, Move *result, float duration, bool debug);  // Initialize search thread
+bb perft_parallel(ChessBoard *board, int depth, int threads, int hash_mb);  // Perft split over threads sharing a hash_mb table
+int perft_divide(ChessBoard *board, int depth, Move *moves, bb *counts);  // Perft per legal root move, returns the move count
+void thread_init(Search *search, ChessBoard *board, Move *result, float duration, bool debug, int threads);  // Run a Lazy SMP search
 void thread_stop(Search *search);                 // Stop search thread
+int search_start(Search *search, ChessBoard *board, bool debug, int threads);  // Start a search within search->limits without blocking
+void search_ponderhit(Search *search);            // Switch a ponder search to normal time management
+bool search_poll(Search *search);                 // Check whether the search has ended
+Move search_wait(Search *search);                 // Block until the search ends, return best move
+uint64_t search_nodes(Search *search);            // Nodes of all threads, live while searching
 
 #endif // BOARD_H
\ No newline at end of file
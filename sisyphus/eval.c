@@ -1,7 +1,76 @@
 #include "eval.h"
+#include <pthread.h>
+
+// Pawn structure weights, indexed by relative rank where it applies
+static const int PASSED_MG[RANK_NB] = {0, 5, 10, 15, 30, 50, 80, 0};
+static const int PASSED_EG[RANK_NB] = {0, 10, 15, 25, 45, 75, 120, 0};
+static const int CONNECTED_MG[RANK_NB] = {0, 5, 7, 10, 15, 25, 40, 0};
+static const int CONNECTED_EG[RANK_NB] = {0, 2, 4, 6, 10, 18, 30, 0};
+#define ISOLATED_MG 5
+#define ISOLATED_EG 15
+#define DOUBLED_MG 10
+#define DOUBLED_EG 25
+#define BACKWARD_MG 8
+#define BACKWARD_EG 10
+
+// Piece activity weights, indexed by piece type where it applies. Mobility is
+// scored relative to a typical number of reachable squares
+static const int MOBILITY_MG[6] = {0, 4, 5, 2, 1, 0};
+static const int MOBILITY_EG[6] = {0, 4, 5, 4, 2, 0};
+static const int MOBILITY_BASE[6] = {0, 4, 6, 6, 12, 0};
+static const int KING_ATTACK_WEIGHT[6] = {0, 2, 2, 3, 5, 0};
+// Percentage of the king attack weight applied by number of attackers
+static const int KING_ATTACKER_SCALE[8] = {0, 0, 50, 75, 88, 94, 97, 99};
+#define KING_DANGER_MG 4
+#define KING_DANGER_EG 1
+#define THREAT_BY_PAWN_MG 50
+#define THREAT_BY_PAWN_EG 40
+#define HANGING_MG 30
+#define HANGING_EG 20
+#define BISHOP_PAIR_MG 30
+#define BISHOP_PAIR_EG 50
+#define ROOK_OPEN_MG 25
+#define ROOK_OPEN_EG 10
+#define ROOK_SEMI_OPEN_MG 12
+#define ROOK_SEMI_OPEN_EG 6
+
+// Attack maps of both sides, built once per evaluation
+typedef struct {
+    bb pawnAttacks[COLOR_NB];
+    bb attacked[COLOR_NB];       // Squares attacked by any piece
+    bb kingZone[COLOR_NB];       // King square and its neighbours
+    int kingAttackers[COLOR_NB]; // Pieces attacking the enemy king zone
+    int kingWeight[COLOR_NB];    // Weighted attacks on the enemy king zone
+} EvalInfo;
+
+static pthread_mutex_t eval_lock = PTHREAD_MUTEX_INITIALIZER;
+static int eval_searches = 0;
+static int eval_changes = 0;
 
 int eval(ChessBoard *board) {
-    return pesto_eval(board);
+    if (nnue_enabled())
+        return nnue_eval(board);
+
+    int mgScore = board->mg[WHITE] - board->mg[BLACK];
+    int egScore = board->eg[WHITE] - board->eg[BLACK];
+
+    int pawnMg, pawnEg;
+    evaluate_pawns(board, &pawnMg, &pawnEg);
+    mgScore += pawnMg;
+    egScore += pawnEg;
+
+    int pieceMg, pieceEg;
+    evaluate_pieces(board, &pieceMg, &pieceEg);
+    mgScore += pieceMg;
+    egScore += pieceEg;
+
+    int mgPhase = board->gamePhase;
+    if (mgPhase > 24)
+        mgPhase = 24;
+    int egPhase = 24 - mgPhase;
+    int score = (mgScore * mgPhase + egScore * egPhase) / 24;
+
+    return (board->color == WHITE) ? score : -score;
 }
 
 int pesto_eval(ChessBoard *board) {
@@ -15,39 +84,207 @@ int pesto_eval(ChessBoard *board) {
     return (mgScore * mgPhase + egScore * egPhase) / 24;
 }
 
-int count_stacked_pawns(bb pawns, int count) {
-    int result = 0;
-    result += popcount(pawns & FILE_A) == count;
-    result += popcount(pawns & FILE_B) == count;
-    result += popcount(pawns & FILE_C) == count;
-    result += popcount(pawns & FILE_D) == count;
-    result += popcount(pawns & FILE_E) == count;
-    result += popcount(pawns & FILE_F) == count;
-    result += popcount(pawns & FILE_G) == count;
-    result += popcount(pawns & FILE_H) == count;
-    return result;
+static void evaluate_side_pawns(ChessBoard *board, int color, int *mg, int *eg) {
+    bb us = board->bb_squares[WHITE_PAWN + color];
+    bb them = board->bb_squares[WHITE_PAWN + (color ^ 1)];
+    bb pawns = us;
+    int sq;
+
+    *mg = *eg = 0;
+    while (pawns) {
+        POP_LSB(sq, pawns);
+        int file = file_of(sq);
+        int rank = color == WHITE ? rank_of(sq) : RANK_NB - 1 - rank_of(sq);
+        int stop = color == WHITE ? sq + 8 : sq - 8;
+        bb adjacent = BB_ADJACENT_FILES[file] & us;
+
+        bool doubled = (BB_FORWARD_FILE[color][sq] & us) != 0;
+        bool passed = !doubled && !(BB_PASSED_SPAN[color][sq] & them);
+        bool supported = (BB_PAWNS[color ^ 1][sq] & us) != 0;
+        bool phalanx = (adjacent & (RANK_1 << (8 * rank_of(sq)))) != 0;
+
+        if (passed) {
+            *mg += PASSED_MG[rank];
+            *eg += PASSED_EG[rank];
+        }
+
+        if (doubled) {
+            *mg -= DOUBLED_MG;
+            *eg -= DOUBLED_EG;
+        }
+
+        if (supported || phalanx) {
+            *mg += CONNECTED_MG[rank];
+            *eg += CONNECTED_EG[rank];
+        } else if (!adjacent) {
+            *mg -= ISOLATED_MG;
+            *eg -= ISOLATED_EG;
+        } else if (!(adjacent & ~BB_PASSED_SPAN[color][sq]) &&
+                   (BB_PAWNS[color][stop] & them)) {
+            // No pawn behind or beside to support the advance, and the stop
+            // square is held by an enemy pawn
+            *mg -= BACKWARD_MG;
+            *eg -= BACKWARD_EG;
+        }
+    }
 }
 
-int evaluate_white_pawns(ChessBoard *board) {
-    bb pawns = board->bb_squares[WHITE_PAWN];
-    int score = 0;
-    score -= count_stacked_pawns(pawns, 2) * 50;
-    score -= count_stacked_pawns(pawns, 3) * 100;
-    return score;
+void evaluate_pawns(ChessBoard *board, int *mg, int *eg) {
+    PawnTable *table = board->pawn_table;
+    if (table && pawn_table_get(table, board->pawn_hash, mg, eg))
+        return;
+
+    int whiteMg, whiteEg, blackMg, blackEg;
+    evaluate_side_pawns(board, WHITE, &whiteMg, &whiteEg);
+    evaluate_side_pawns(board, BLACK, &blackMg, &blackEg);
+    *mg = whiteMg - blackMg;
+    *eg = whiteEg - blackEg;
+
+    if (table)
+        pawn_table_set(table, board->pawn_hash, *mg, *eg);
 }
 
-int evaluate_black_pawns(ChessBoard *board) {
-    bb pawns = board->bb_squares[BLACK_PAWN];
-    int score = 0;
-    score -= count_stacked_pawns(pawns, 2) * 50;
-    score -= count_stacked_pawns(pawns, 3) * 100;
-    return score;
+INLINE bb pawn_attacks(bb pawns, int color) {
+    if (color == WHITE)
+        return ((pawns & ~FILE_A) << 7) | ((pawns & ~FILE_H) << 9);
+    return ((pawns & ~FILE_A) >> 9) | ((pawns & ~FILE_H) >> 7);
 }
 
-int evaluate_pawns(ChessBoard *board) {
-    int score = 0;
-    score += evaluate_white_pawns(board);
-    score -= evaluate_black_pawns(board);
+// Mobility, king attacks and rook files of one side, filling its attack map
+static void evaluate_side_pieces(ChessBoard *board, EvalInfo *ei, int color,
+                                 int *mg, int *eg) {
+    int them = color ^ 1;
+    bb occ = board->occ[BOTH];
+    bb area = ~(board->occ[color] | ei->pawnAttacks[them]);
+    bb ourPawns = board->bb_squares[WHITE_PAWN + color];
+    bb theirPawns = board->bb_squares[WHITE_PAWN + them];
+    int sq;
 
-    return (board->color == WHITE) ? score : -score;
-}
\ No newline at end of file
+    *mg = *eg = 0;
+    for (int pt = KNIGHT; pt <= QUEEN; pt++) {
+        bb pieces = board->bb_squares[make_piece_type(pt, color)];
+        while (pieces) {
+            POP_LSB(sq, pieces);
+
+            bb attacks;
+            if (pt == KNIGHT)
+                attacks = BB_KNIGHT[sq];
+            else if (pt == BISHOP)
+                attacks = bb_bishop(sq, occ);
+            else if (pt == ROOK)
+                attacks = bb_rook(sq, occ);
+            else
+                attacks = bb_queen(sq, occ);
+            ei->attacked[color] |= attacks;
+
+            int mobility = popcount(attacks & area) - MOBILITY_BASE[pt];
+            *mg += MOBILITY_MG[pt] * mobility;
+            *eg += MOBILITY_EG[pt] * mobility;
+
+            bb zone = attacks & ei->kingZone[them];
+            if (zone) {
+                ei->kingAttackers[color]++;
+                ei->kingWeight[color] += KING_ATTACK_WEIGHT[pt] * popcount(zone);
+            }
+
+            if (pt == ROOK && !((FILE_A << file_of(sq)) & ourPawns)) {
+                bool open = !((FILE_A << file_of(sq)) & theirPawns);
+                *mg += open ? ROOK_OPEN_MG : ROOK_SEMI_OPEN_MG;
+                *eg += open ? ROOK_OPEN_EG : ROOK_SEMI_OPEN_EG;
+            }
+        }
+    }
+
+    if (several(board->bb_squares[make_piece_type(BISHOP, color)])) {
+        *mg += BISHOP_PAIR_MG;
+        *eg += BISHOP_PAIR_EG;
+    }
+}
+
+// Enemy pieces attacked by pawns, or attacked and left undefended
+static void evaluate_side_threats(ChessBoard *board, EvalInfo *ei, int color,
+                                  int *mg, int *eg) {
+    int them = color ^ 1;
+    bb targets = board->occ[them] & ~board->bb_squares[WHITE_PAWN + them] &
+                 ~board->bb_squares[WHITE_KING + them];
+
+    int byPawn = popcount(targets & ei->pawnAttacks[color]);
+    int hanging = popcount(board->occ[them] & ~board->bb_squares[WHITE_KING + them] &
+                           ei->attacked[color] & ~ei->attacked[them]);
+
+    *mg = byPawn * THREAT_BY_PAWN_MG + hanging * HANGING_MG;
+    *eg = byPawn * THREAT_BY_PAWN_EG + hanging * HANGING_EG;
+}
+
+void evaluate_pieces(ChessBoard *board, int *mg, int *eg) {
+    EvalInfo ei;
+    int sideMg[COLOR_NB], sideEg[COLOR_NB];
+
+    for (int c = WHITE; c <= BLACK; c++) {
+        bb king = board->bb_squares[WHITE_KING + c];
+        bb kingAttacks = king ? BB_KING[get_lsb(king)] : 0;
+        ei.pawnAttacks[c] = pawn_attacks(board->bb_squares[WHITE_PAWN + c], c);
+        ei.kingZone[c] = kingAttacks | king;
+        ei.attacked[c] = ei.pawnAttacks[c] | kingAttacks;
+        ei.kingAttackers[c] = ei.kingWeight[c] = 0;
+    }
+
+    for (int c = WHITE; c <= BLACK; c++)
+        evaluate_side_pieces(board, &ei, c, &sideMg[c], &sideEg[c]);
+
+    // Threats need both attack maps complete
+    for (int c = WHITE; c <= BLACK; c++) {
+        int threatMg, threatEg;
+        evaluate_side_threats(board, &ei, c, &threatMg, &threatEg);
+        sideMg[c] += threatMg;
+        sideEg[c] += threatEg;
+
+        int attackers = ei.kingAttackers[c] < 7 ? ei.kingAttackers[c] : 7;
+        int danger = ei.kingWeight[c] * KING_ATTACKER_SCALE[attackers] / 100;
+        sideMg[c] += danger * KING_DANGER_MG;
+        sideEg[c] += danger * KING_DANGER_EG;
+    }
+
+    *mg = sideMg[WHITE] - sideMg[BLACK];
+    *eg = sideEg[WHITE] - sideEg[BLACK];
+}
+
+void eval_search_begin(void) {
+    pthread_mutex_lock(&eval_lock);
+    eval_searches++;
+    pthread_mutex_unlock(&eval_lock);
+}
+
+void eval_search_end(void) {
+    pthread_mutex_lock(&eval_lock);
+    eval_searches--;
+    pthread_mutex_unlock(&eval_lock);
+}
+
+bool eval_searching(void) {
+    pthread_mutex_lock(&eval_lock);
+    bool searching = eval_searches > 0;
+    pthread_mutex_unlock(&eval_lock);
+    return searching;
+}
+
+bool eval_lock_idle(void) {
+    pthread_mutex_lock(&eval_lock);
+    if (eval_searches == 0)
+        return true;
+    pthread_mutex_unlock(&eval_lock);
+    return false;
+}
+
+void eval_unlock(bool changed) {
+    if (changed)
+        eval_changes++;
+    pthread_mutex_unlock(&eval_lock);
+}
+
+int eval_version(void) {
+    pthread_mutex_lock(&eval_lock);
+    int version = eval_changes;
+    pthread_mutex_unlock(&eval_lock);
+    return version;
+}
@@ -3,12 +3,41 @@
 
 #include "bb.h"
 #include "board.h"
+#include "nnue.h"
+#include "table.h"
 #include "types.h"
 
+// Material and piece-square evaluation, side to move relative
 int pesto_eval(ChessBoard *board);
 
-int evaluate_pawns(ChessBoard *board);
+// Pawn structure score, white relative, cached in board->pawn_table if set
+void evaluate_pawns(ChessBoard *board, int *mg, int *eg);
 
+// Mobility, king safety, threats, bishop pair and rook files from per side
+// attack maps, white relative
+void evaluate_pieces(ChessBoard *board, int *mg, int *eg);
+
+// Static evaluation, side to move relative: the network when one is loaded
+// and enabled, PESTO with the pawn and piece layers otherwise
 int eval(ChessBoard *board);
 
+// Searches read the evaluation parameters without locking. Each search thread
+// registers between these two calls, parameters only change while none does.
+void eval_search_begin(void);
+void eval_search_end(void);
+
+// True while any search thread is registered
+bool eval_searching(void);
+
+// Take the lock guarding the evaluation parameters, false without taking it
+// while a search is running
+bool eval_lock_idle(void);
+
+// Release the lock, with changed set the evaluator differs from before and
+// static evaluations cached in transposition tables are dropped
+void eval_unlock(bool changed);
+
+// Counter bumped on every change of the evaluator
+int eval_version(void);
+
 #endif // EVAL_H
\ No newline at end of file
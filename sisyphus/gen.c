@@ -254,10 +254,6 @@ INLINE int gen_white_attacks_against(ChessBoard *board, Move *moves, bb mask) {
     return moves - ptr;
 }
 
-INLINE int gen_white_checks(ChessBoard *board, Move *moves) {
-    return gen_white_attacks_against(board, moves, board->bb_squares[BLACK_KING]);
-}
-
 int gen_black_pawn_moves(ChessBoard *board, Move *moves) {
     Move *ptr = moves;
     bb pawns = board->bb_squares[BLACK_PAWN];
@@ -438,8 +434,341 @@ INLINE int gen_black_attacks_against(ChessBoard *board, Move *moves, bb mask) {
     return moves - ptr;
 }
 
-INLINE int gen_black_checks(ChessBoard *board, Move *moves) {
-    return gen_black_attacks_against(board, moves, board->bb_squares[WHITE_KING]);
+int gen_white_pawn_noisy(ChessBoard *board, Move *moves) {
+    Move *ptr = moves;
+    bb pawns = board->bb_squares[WHITE_PAWN];
+    bb mask = board->occ[BLACK] | board->ep;
+    bb promo = 0xff00000000000000L;
+    bb p1 = (pawns << 8) & ~board->occ[BOTH] & promo;
+    bb a1 = ((pawns & 0xfefefefefefefefeL) << 7) & mask;
+    bb a2 = ((pawns & 0x7f7f7f7f7f7f7f7fL) << 9) & mask;
+    int sq;
+
+    while (p1) {
+        POP_LSB(sq, p1);
+        EMIT_PROMOTIONS(moves, sq - 8, sq, WHITE_PAWN);
+    }
+
+    while (a1) {
+        POP_LSB(sq, a1);
+        if (test_bit(promo, sq)) {
+            EMIT_PROMOTIONS(moves, sq - 7, sq, WHITE_PAWN);
+        } else if (test_bit(board->ep, sq)) {
+            EMIT_EN_PASSANT(moves, sq - 7, sq, WHITE_PAWN);
+        } else {
+            EMIT_MOVE(moves, sq - 7, sq, WHITE_PAWN, EMPTY_FLAG);
+        }
+    }
+
+    while (a2) {
+        POP_LSB(sq, a2);
+        if (test_bit(promo, sq)) {
+            EMIT_PROMOTIONS(moves, sq - 9, sq, WHITE_PAWN);
+        } else if (test_bit(board->ep, sq)) {
+            EMIT_EN_PASSANT(moves, sq - 9, sq, WHITE_PAWN);
+        } else {
+            EMIT_MOVE(moves, sq - 9, sq, WHITE_PAWN, EMPTY_FLAG);
+        }
+    }
+
+    return moves - ptr;
+}
+
+int gen_white_pawn_quiet(ChessBoard *board, Move *moves) {
+    Move *ptr = moves;
+    bb pawns = board->bb_squares[WHITE_PAWN];
+    bb p1 = (pawns << 8) & ~board->occ[BOTH];
+    bb p2 = ((p1 & 0x0000000000ff0000L) << 8) & ~board->occ[BOTH];
+    int sq;
+
+    p1 &= ~0xff00000000000000L;
+
+    while (p1) {
+        POP_LSB(sq, p1);
+        EMIT_MOVE(moves, sq - 8, sq, WHITE_PAWN, EMPTY_FLAG);
+    }
+
+    while (p2) {
+        POP_LSB(sq, p2);
+        EMIT_MOVE(moves, sq - 16, sq, WHITE_PAWN, EMPTY_FLAG);
+    }
+
+    return moves - ptr;
+}
+
+int gen_white_noisy_moves(ChessBoard *board, Move *moves) {
+    Move *ptr = moves;
+    bb mask = board->occ[BLACK], all = board->occ[BOTH];
+
+    moves += gen_white_pawn_noisy(board, moves);
+    moves += gen_knight_moves(moves, board->bb_squares[WHITE_KNIGHT], mask, WHITE);
+    moves += gen_bishop_moves(moves, board->bb_squares[WHITE_BISHOP], mask, all, WHITE);
+    moves += gen_rook_moves(moves, board->bb_squares[WHITE_ROOK], mask, all, WHITE);
+    moves += gen_queen_moves(moves, board->bb_squares[WHITE_QUEEN], mask, all, WHITE);
+    moves += gen_king_moves(moves, board->bb_squares[WHITE_KING], mask, WHITE);
+
+    return moves - ptr;
+}
+
+int gen_white_quiet_moves(ChessBoard *board, Move *moves) {
+    Move *ptr = moves;
+    bb mask = ~board->occ[BOTH], all = board->occ[BOTH];
+
+    moves += gen_white_pawn_quiet(board, moves);
+    moves += gen_knight_moves(moves, board->bb_squares[WHITE_KNIGHT], mask, WHITE);
+    moves += gen_bishop_moves(moves, board->bb_squares[WHITE_BISHOP], mask, all, WHITE);
+    moves += gen_rook_moves(moves, board->bb_squares[WHITE_ROOK], mask, all, WHITE);
+    moves += gen_queen_moves(moves, board->bb_squares[WHITE_QUEEN], mask, all, WHITE);
+    moves += gen_king_moves(moves, board->bb_squares[WHITE_KING], mask, WHITE);
+    moves += gen_white_king_castle(board, moves);
+
+    return moves - ptr;
+}
+
+int gen_black_pawn_noisy(ChessBoard *board, Move *moves) {
+    Move *ptr = moves;
+    bb pawns = board->bb_squares[BLACK_PAWN];
+    bb mask = board->occ[WHITE] | board->ep;
+    bb promo = 0x00000000000000ffL;
+    bb p1 = (pawns >> 8) & ~board->occ[BOTH] & promo;
+    bb a1 = ((pawns & 0x7f7f7f7f7f7f7f7fL) >> 7) & mask;
+    bb a2 = ((pawns & 0xfefefefefefefefeL) >> 9) & mask;
+    int sq;
+
+    while (p1) {
+        POP_LSB(sq, p1);
+        EMIT_PROMOTIONS(moves, sq + 8, sq, BLACK_PAWN);
+    }
+
+    while (a1) {
+        POP_LSB(sq, a1);
+        if (test_bit(promo, sq)) {
+            EMIT_PROMOTIONS(moves, sq + 7, sq, BLACK_PAWN);
+        } else if (test_bit(board->ep, sq)) {
+            EMIT_EN_PASSANT(moves, sq + 7, sq, BLACK_PAWN);
+        } else {
+            EMIT_MOVE(moves, sq + 7, sq, BLACK_PAWN, EMPTY_FLAG);
+        }
+    }
+
+    while (a2) {
+        POP_LSB(sq, a2);
+        if (test_bit(promo, sq)) {
+            EMIT_PROMOTIONS(moves, sq + 9, sq, BLACK_PAWN);
+        } else if (test_bit(board->ep, sq)) {
+            EMIT_EN_PASSANT(moves, sq + 9, sq, BLACK_PAWN);
+        } else {
+            EMIT_MOVE(moves, sq + 9, sq, BLACK_PAWN, EMPTY_FLAG);
+        }
+    }
+
+    return moves - ptr;
+}
+
+int gen_black_pawn_quiet(ChessBoard *board, Move *moves) {
+    Move *ptr = moves;
+    bb pawns = board->bb_squares[BLACK_PAWN];
+    bb p1 = (pawns >> 8) & ~board->occ[BOTH];
+    bb p2 = ((p1 & 0x0000ff0000000000L) >> 8) & ~board->occ[BOTH];
+    int sq;
+
+    p1 &= ~0x00000000000000ffL;
+
+    while (p1) {
+        POP_LSB(sq, p1);
+        EMIT_MOVE(moves, sq + 8, sq, BLACK_PAWN, EMPTY_FLAG);
+    }
+
+    while (p2) {
+        POP_LSB(sq, p2);
+        EMIT_MOVE(moves, sq + 16, sq, BLACK_PAWN, EMPTY_FLAG);
+    }
+
+    return moves - ptr;
+}
+
+int gen_black_noisy_moves(ChessBoard *board, Move *moves) {
+    Move *ptr = moves;
+    bb mask = board->occ[WHITE], all = board->occ[BOTH];
+
+    moves += gen_black_pawn_noisy(board, moves);
+    moves += gen_knight_moves(moves, board->bb_squares[BLACK_KNIGHT], mask, BLACK);
+    moves += gen_bishop_moves(moves, board->bb_squares[BLACK_BISHOP], mask, all, BLACK);
+    moves += gen_rook_moves(moves, board->bb_squares[BLACK_ROOK], mask, all, BLACK);
+    moves += gen_queen_moves(moves, board->bb_squares[BLACK_QUEEN], mask, all, BLACK);
+    moves += gen_king_moves(moves, board->bb_squares[BLACK_KING], mask, BLACK);
+
+    return moves - ptr;
+}
+
+int gen_black_quiet_moves(ChessBoard *board, Move *moves) {
+    Move *ptr = moves;
+    bb mask = ~board->occ[BOTH], all = board->occ[BOTH];
+
+    moves += gen_black_pawn_quiet(board, moves);
+    moves += gen_knight_moves(moves, board->bb_squares[BLACK_KNIGHT], mask, BLACK);
+    moves += gen_bishop_moves(moves, board->bb_squares[BLACK_BISHOP], mask, all, BLACK);
+    moves += gen_rook_moves(moves, board->bb_squares[BLACK_ROOK], mask, all, BLACK);
+    moves += gen_queen_moves(moves, board->bb_squares[BLACK_QUEEN], mask, all, BLACK);
+    moves += gen_king_moves(moves, board->bb_squares[BLACK_KING], mask, BLACK);
+    moves += gen_black_king_castle(board, moves);
+
+    return moves - ptr;
+}
+
+int gen_white_pawn_evasions(ChessBoard *board, Move *moves, bb target) {
+    Move *ptr = moves;
+    bb pawns = board->bb_squares[WHITE_PAWN];
+    bb mask = board->occ[BLACK] & target;
+    bb promo = 0xff00000000000000L;
+    bb p1 = (pawns << 8) & ~board->occ[BOTH];
+    bb p2 = ((p1 & 0x0000000000ff0000L) << 8) & ~board->occ[BOTH] & target;
+    int sq;
+
+    // Only the pawn that just moved can be taken en passant to end the check
+    if (board->checkers & (board->ep >> 8))
+        mask |= board->ep;
+
+    bb a1 = ((pawns & 0xfefefefefefefefeL) << 7) & mask;
+    bb a2 = ((pawns & 0x7f7f7f7f7f7f7f7fL) << 9) & mask;
+    p1 &= target;
+
+    while (p1) {
+        POP_LSB(sq, p1);
+        if (test_bit(promo, sq)) {
+            EMIT_PROMOTIONS(moves, sq - 8, sq, WHITE_PAWN);
+        } else {
+            EMIT_MOVE(moves, sq - 8, sq, WHITE_PAWN, EMPTY_FLAG);
+        }
+    }
+
+    while (p2) {
+        POP_LSB(sq, p2);
+        EMIT_MOVE(moves, sq - 16, sq, WHITE_PAWN, EMPTY_FLAG);
+    }
+
+    while (a1) {
+        POP_LSB(sq, a1);
+        if (test_bit(promo, sq)) {
+            EMIT_PROMOTIONS(moves, sq - 7, sq, WHITE_PAWN);
+        } else if (test_bit(board->ep, sq)) {
+            EMIT_EN_PASSANT(moves, sq - 7, sq, WHITE_PAWN);
+        } else {
+            EMIT_MOVE(moves, sq - 7, sq, WHITE_PAWN, EMPTY_FLAG);
+        }
+    }
+
+    while (a2) {
+        POP_LSB(sq, a2);
+        if (test_bit(promo, sq)) {
+            EMIT_PROMOTIONS(moves, sq - 9, sq, WHITE_PAWN);
+        } else if (test_bit(board->ep, sq)) {
+            EMIT_EN_PASSANT(moves, sq - 9, sq, WHITE_PAWN);
+        } else {
+            EMIT_MOVE(moves, sq - 9, sq, WHITE_PAWN, EMPTY_FLAG);
+        }
+    }
+
+    return moves - ptr;
+}
+
+int gen_black_pawn_evasions(ChessBoard *board, Move *moves, bb target) {
+    Move *ptr = moves;
+    bb pawns = board->bb_squares[BLACK_PAWN];
+    bb mask = board->occ[WHITE] & target;
+    bb promo = 0x00000000000000ffL;
+    bb p1 = (pawns >> 8) & ~board->occ[BOTH];
+    bb p2 = ((p1 & 0x0000ff0000000000L) >> 8) & ~board->occ[BOTH] & target;
+    int sq;
+
+    // Only the pawn that just moved can be taken en passant to end the check
+    if (board->checkers & (board->ep << 8))
+        mask |= board->ep;
+
+    bb a1 = ((pawns & 0x7f7f7f7f7f7f7f7fL) >> 7) & mask;
+    bb a2 = ((pawns & 0xfefefefefefefefeL) >> 9) & mask;
+    p1 &= target;
+
+    while (p1) {
+        POP_LSB(sq, p1);
+        if (test_bit(promo, sq)) {
+            EMIT_PROMOTIONS(moves, sq + 8, sq, BLACK_PAWN);
+        } else {
+            EMIT_MOVE(moves, sq + 8, sq, BLACK_PAWN, EMPTY_FLAG);
+        }
+    }
+
+    while (p2) {
+        POP_LSB(sq, p2);
+        EMIT_MOVE(moves, sq + 16, sq, BLACK_PAWN, EMPTY_FLAG);
+    }
+
+    while (a1) {
+        POP_LSB(sq, a1);
+        if (test_bit(promo, sq)) {
+            EMIT_PROMOTIONS(moves, sq + 7, sq, BLACK_PAWN);
+        } else if (test_bit(board->ep, sq)) {
+            EMIT_EN_PASSANT(moves, sq + 7, sq, BLACK_PAWN);
+        } else {
+            EMIT_MOVE(moves, sq + 7, sq, BLACK_PAWN, EMPTY_FLAG);
+        }
+    }
+
+    while (a2) {
+        POP_LSB(sq, a2);
+        if (test_bit(promo, sq)) {
+            EMIT_PROMOTIONS(moves, sq + 9, sq, BLACK_PAWN);
+        } else if (test_bit(board->ep, sq)) {
+            EMIT_EN_PASSANT(moves, sq + 9, sq, BLACK_PAWN);
+        } else {
+            EMIT_MOVE(moves, sq + 9, sq, BLACK_PAWN, EMPTY_FLAG);
+        }
+    }
+
+    return moves - ptr;
+}
+
+int gen_evasions(ChessBoard *board, Move *moves) {
+    Move *ptr = moves;
+    int color = board->color;
+    bb king = board->bb_squares[WHITE_KING + color];
+    bb checkers = board->checkers, all = board->occ[BOTH];
+
+    if (!king || !checkers)
+        return 0;
+
+    // King moves, attacked squares are left to the legality test
+    moves += gen_king_moves(moves, king, ~board->occ[color], color);
+
+    // A double check can only be answered by the king
+    if (several(checkers))
+        return moves - ptr;
+
+    // Capture the checker or block the ray between it and the king
+    bb target = BB_BETWEEN[get_lsb(king)][get_lsb(checkers)] | checkers;
+
+    moves += color ? gen_black_pawn_evasions(board, moves, target)
+             : gen_white_pawn_evasions(board, moves, target);
+    moves += gen_knight_moves(moves, board->bb_squares[WHITE_KNIGHT + color],
+                              target, color);
+    moves += gen_bishop_moves(moves, board->bb_squares[WHITE_BISHOP + color],
+                              target, all, color);
+    moves += gen_rook_moves(moves, board->bb_squares[WHITE_ROOK + color], target,
+                            all, color);
+    moves += gen_queen_moves(moves, board->bb_squares[WHITE_QUEEN + color],
+                             target, all, color);
+
+    return moves - ptr;
+}
+
+INLINE int gen_noisy_moves(ChessBoard *board, Move *moves) {
+    return board->color ? gen_black_noisy_moves(board, moves)
+           : gen_white_noisy_moves(board, moves);
+}
+
+INLINE int gen_quiet_moves(ChessBoard *board, Move *moves) {
+    return board->color ? gen_black_quiet_moves(board, moves)
+           : gen_white_quiet_moves(board, moves);
 }
 
 INLINE int gen_moves(ChessBoard *board, Move *moves) {
@@ -453,20 +782,63 @@ INLINE int gen_attacks(ChessBoard *board, Move *moves) {
            : gen_white_attacks_against(board, moves, board->occ[BLACK]);
 }
 
-INLINE int gen_legal_moves(ChessBoard *board, Move *moves) {
+// Legality of a pseudo-legal move given the pinned pieces of the side to
+// move, without making it
+INLINE int legal_move(ChessBoard *board, const Move move, bb pinned) {
+    int src = EXTRACT_FROM(move), dst = EXTRACT_TO(move);
+    int piece = EXTRACT_PIECE(move), flag = EXTRACT_FLAGS(move);
+    int color = board->color;
+    bb king = board->bb_squares[WHITE_KING + color];
+    bb checkers = board->checkers;
+
+    if (!king)
+        return 1;
+
+    // The king may not step onto an attacked square, the king itself no
+    // longer blocks the sliders it moves away from
+    if (PIECE(piece) == KING)
+        return !(attacks_to_square(board, dst, board->occ[BOTH] ^ BIT(src)) &
+                 board->occ[!color]);
+
+    int ksq = get_lsb(king);
+
+    // Both pawns leave the rank, which may expose the king to a slider
+    if (IS_ENP(flag)) {
+        int cap = color == WHITE ? dst - 8 : dst + 8;
+        bb occ = (board->occ[BOTH] ^ BIT(src) ^ BIT(cap)) | BIT(dst);
+        return !(attacks_to_square(board, ksq, occ) & board->occ[!color] &
+                 ~BIT(cap));
+    }
+
+    // Evasions capture the checker or block its ray, double checks need a
+    // king move
+    if (checkers && (several(checkers) ||
+                     !((BB_BETWEEN[ksq][get_lsb(checkers)] | checkers) & BIT(dst))))
+        return 0;
+
+    // Pinned pieces stay on the line through the king
+    return !(pinned & BIT(src)) || (BB_LINE[src][ksq] & BIT(dst));
+}
+
+int gen_legal_moves(ChessBoard *board, Move *moves) {
     Move temp[MAX_MOVES];
-    Undo undo;
-    int count = gen_moves(board, temp), size = 0;
+    bb pinned = board_pinned(board);
+    int count = board->checkers ? gen_evasions(board, temp)
+                : gen_moves(board, temp);
+    int size = 0;
+
     for (int i = 0; i < count; i++) {
-        Move move = temp[i];
-        do_move(board, move, &undo);
-        if (!illegal_to_move(board))
-            moves[size++] = move;
-        undo_move(board, move, &undo);
+        if (legal_move(board, temp[i], pinned))
+            moves[size++] = temp[i];
     }
     return size;
 }
 
+int is_legal(ChessBoard *board, const Move move) {
+    return is_pseudo_legal(board, move) &&
+           legal_move(board, move, board_pinned(board));
+}
+
 INLINE int illegal_to_move(ChessBoard *board) {
     return board->color
            ? attacks_to_king_square(board, board->bb_squares[WHITE_KING])
@@ -474,17 +846,120 @@ INLINE int illegal_to_move(ChessBoard *board) {
 }
 
 INLINE int is_check(ChessBoard *board) {
-    Move moves[MAX_MOVES];
-    return board->color ? gen_white_checks(board, moves)
-           : gen_black_checks(board, moves);
+    return board->checkers != 0;
+}
+
+int gives_check(ChessBoard *board, const CheckInfo *ci, const Move move) {
+    int src = EXTRACT_FROM(move), dst = EXTRACT_TO(move);
+    int piece = EXTRACT_PIECE(move), flag = EXTRACT_FLAGS(move);
+    int color = COLOR(piece), ksq = ci->king;
+
+    if (ksq < 0)
+        return 0;
+
+    // Direct check
+    if (ci->squares[piece >> 1] & BIT(dst))
+        return 1;
+
+    // Discovered check, the blocker leaves the line to the king
+    if ((ci->blockers & BIT(src)) && !(BB_LINE[src][ksq] & BIT(dst)))
+        return 1;
+
+    if (IS_PROMO(flag)) {
+        bb occ = board->occ[BOTH] ^ BIT(src);
+        switch (PROMO_PT(flag)) {
+        case KNIGHT:
+            return (BB_KNIGHT[dst] & BIT(ksq)) != 0;
+        case BISHOP:
+            return (bb_bishop(dst, occ) & BIT(ksq)) != 0;
+        case ROOK:
+            return (bb_rook(dst, occ) & BIT(ksq)) != 0;
+        default:
+            return (bb_queen(dst, occ) & BIT(ksq)) != 0;
+        }
+    }
+
+    // The captured pawn may uncover a slider on the king
+    if (IS_ENP(flag)) {
+        int cap = color == WHITE ? dst - 8 : dst + 8;
+        bb occ = (board->occ[BOTH] ^ BIT(src) ^ BIT(cap)) | BIT(dst);
+        bb rooks = board->bb_squares[WHITE_ROOK + color] |
+                   board->bb_squares[WHITE_QUEEN + color];
+        bb bishops = board->bb_squares[WHITE_BISHOP + color] |
+                     board->bb_squares[WHITE_QUEEN + color];
+        return ((bb_rook(ksq, occ) & rooks) | (bb_bishop(ksq, occ) & bishops)) != 0;
+    }
+
+    // The castling rook may give check from its new square
+    if (IS_CAS(flag)) {
+        int rook_src = dst > src ? src + 3 : src - 4;
+        int rook_dst = dst > src ? src + 1 : src - 1;
+        bb occ = (board->occ[BOTH] ^ BIT(src) ^ BIT(rook_src)) | BIT(dst) |
+                 BIT(rook_dst);
+        return (bb_rook(rook_dst, occ) & BIT(ksq)) != 0;
+    }
+
+    return 0;
 }
 
 int move_gives_check(ChessBoard *board, const Move move) {
-    Undo undo;
+    CheckInfo ci;
+
+    check_info_init(board, &ci);
+    return gives_check(board, &ci, move);
+}
 
-    do_move(board, move, &undo);
-    int flag = is_check(board);
-    undo_move(board, move, &undo);
+int is_pseudo_legal(ChessBoard *board, const Move move) {
+    int src = EXTRACT_FROM(move), dst = EXTRACT_TO(move);
+    int piece = EXTRACT_PIECE(move), flag = EXTRACT_FLAGS(move);
+    int color = board->color;
 
-    return flag;
+    if (move == NULL_MOVE || board->squares[src] != piece ||
+            COLOR(piece) != color || test_bit(board->occ[color], dst))
+        return 0;
+
+    if (IS_CAS(flag)) {
+        Move castles[2];
+        int count = color ? gen_black_king_castle(board, castles)
+                    : gen_white_king_castle(board, castles);
+        for (int i = 0; i < count; i++) {
+            if (castles[i] == move)
+                return 1;
+        }
+        return 0;
+    }
+
+    if (PIECE(piece) == PAWN) {
+        const int push = color ? -8 : 8;
+        const bb promo = color ? RANK_1 : RANK_8;
+        const bb start = color ? RANK_7 : RANK_2;
+
+        if (IS_ENP(flag))
+            return test_bit(board->ep, dst) && test_bit(BB_PAWNS[color][src], dst);
+        if ((flag != EMPTY_FLAG && !IS_PROMO(flag)) ||
+                IS_PROMO(flag) != test_bit(promo, dst))
+            return 0;
+        if (board->squares[dst] != NONE)
+            return test_bit(BB_PAWNS[color][src], dst);
+        if (dst == src + push)
+            return 1;
+        return dst == src + 2 * push && test_bit(start, src) &&
+               board->squares[src + push] == NONE;
+    }
+
+    if (flag != EMPTY_FLAG)
+        return 0;
+
+    switch (PIECE(piece)) {
+    case KNIGHT:
+        return test_bit(BB_KNIGHT[src], dst);
+    case BISHOP:
+        return test_bit(bb_bishop(src, board->occ[BOTH]), dst);
+    case ROOK:
+        return test_bit(bb_rook(src, board->occ[BOTH]), dst);
+    case QUEEN:
+        return test_bit(bb_queen(src, board->occ[BOTH]), dst);
+    default:
+        return test_bit(BB_KING[src], dst);
+    }
 }
\ No newline at end of file
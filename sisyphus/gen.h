@@ -48,10 +48,16 @@ int gen_knight_moves(Move *moves, bb srcs, bb mask, int color);  // Generate kni
 int gen_attacks(ChessBoard *board, Move *moves);                  // Generate all attacking moves
 int gen_legal_moves(ChessBoard *board, Move *moves);             // Generate all legal moves
 int gen_moves(ChessBoard *board, Move *moves);                   // Generate all possible moves
+int gen_noisy_moves(ChessBoard *board, Move *moves);             // Generate captures and promotions
+int gen_quiet_moves(ChessBoard *board, Move *moves);             // Generate non-capturing, non-promoting moves
+int gen_evasions(ChessBoard *board, Move *moves);                // Generate check evasions when in check
 
 // Move validation and check detection
 int illegal_to_move(ChessBoard *board);                          // Check if position is illegal
 int is_check(ChessBoard *board);                                 // Check if king is in check
 int move_gives_check(ChessBoard *board, const Move move);        // Check if move gives check
+int gives_check(ChessBoard *board, const CheckInfo *ci, const Move move);  // Same using precomputed check info
+int is_pseudo_legal(ChessBoard *board, const Move move);         // Check if move can be generated in position
+int is_legal(ChessBoard *board, const Move move);                // Check if move is legal in position
 
 #endif // GEN_H
\ No newline at end of file
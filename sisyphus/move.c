@@ -1,7 +1,5 @@
 #include "move.h"
-
-int History_Heuristic[COLOR_NB][SQUARE_NB][SQUARE_NB] = {0};
-Move KILLER_MOVES[COLOR_NB][64] = {0};
+#include "nnue.h"
 
 const char *PROMOTION_TO_CHAR = "-nbrq-";
 
@@ -54,6 +52,7 @@ void do_move(ChessBoard *board, Move move, Undo *undo) {
     undo->capture = board->squares[dst];
     undo->ep = board->ep;
     undo->castle = board->castle;
+    undo->checkers = board->checkers;
 
     board_update(board, src, NONE);
 
@@ -115,6 +114,14 @@ void do_move(ChessBoard *board, Move move, Undo *undo) {
     SWITCH_SIDE(board);
     board->hash ^= HASH_COLOR_SIDE;
     TOGGLE_HASH(board);
+
+    board->checkers = board_checkers(board);
+
+    if (board->nnue != NULL)
+        nnue_push(board->nnue, move, undo->capture);
+
+    if (board->table != NULL)
+        table_prefetch(board->table, board->hash);
 }
 
 void undo_move(ChessBoard *board, Move move, Undo *undo) {
@@ -133,6 +140,7 @@ void undo_move(ChessBoard *board, Move move, Undo *undo) {
 
     board->ep = undo->ep;
     board->castle = undo->castle;
+    board->checkers = undo->checkers;
 
     board_update(board, src, piece);
 
@@ -173,13 +181,18 @@ void undo_move(ChessBoard *board, Move move, Undo *undo) {
     board->hash ^= HASH_COLOR_SIDE;
     TOGGLE_HASH(board);
     board->numMoves--;
+
+    if (board->nnue != NULL)
+        nnue_pop(board->nnue);
 }
 
 void do_null_move_pruning(ChessBoard *board, Undo *undo) {
     board->m_history[board->numMoves++] = board->hash;
     TOGGLE_HASH(board);
     undo->ep = board->ep;
+    undo->checkers = board->checkers;
     board->ep = U64(0);
+    board->checkers = U64(0);
     SWITCH_SIDE(board);
     board->hash ^= HASH_COLOR_SIDE;
     TOGGLE_HASH(board);
@@ -188,6 +201,7 @@ void do_null_move_pruning(ChessBoard *board, Undo *undo) {
 void undo_null_move_pruning(ChessBoard *board, Undo *undo) {
     TOGGLE_HASH(board);
     board->ep = undo->ep;
+    board->checkers = undo->checkers;
     SWITCH_SIDE(board);
     board->hash ^= HASH_COLOR_SIDE;
     TOGGLE_HASH(board);
@@ -237,8 +251,7 @@ INLINE int move_estimated_value(ChessBoard *board, Move move) {
     return value;
 }
 
-char *move_to_str(Move move) {
-    static char buffer[6];
+char *move_to_str(Move move, char buffer[MOVE_STR_SIZE]) {
     int src = EXTRACT_FROM(move), dst = EXTRACT_TO(move);
     int flag = EXTRACT_FLAGS(move);
     if (IS_PROMO(flag)) {
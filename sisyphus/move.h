@@ -8,8 +8,7 @@
 #include <assert.h>
 #include <stdbool.h>
 
-// Constants
-#define MAX_MOVES 218 // Maximum possible moves in any position
+#define MOVE_STR_SIZE 6 // Longest move string "e7e8q" plus terminator
 
 // Move flags for different types of moves
 #define EMPTY_FLAG 0          // Normal move
@@ -53,8 +52,6 @@
 #define EXTRACT_PIECE(move) ((int)(((move) >> 12) & 0xf))   // Get piece type
 
 // Move scoring tables
-extern int History_Heuristic[COLOR_NB][SQUARE_NB][SQUARE_NB];
-extern Move KILLER_MOVES[COLOR_NB][SQUARE_NB];
 extern const int MVV_LVA[6][6];
 static const int SEEPieceValues[] = {
     103, 422, 437, 694, 1313, 0, 0, 0,
@@ -74,7 +71,7 @@ void undo_null_move_pruning(ChessBoard *board, Undo *undo);  // Undo null move
 void do_null_move_pruning(ChessBoard *board, Undo *undo);    // Make null move
 
 // Utility functions  
-char *move_to_str(Move move);                                // Convert move to string
+char *move_to_str(Move move, char buffer[MOVE_STR_SIZE]);    // Convert move to string
 bool is_capture(ChessBoard *board, const Move move);         // Check if move is capture
 bool is_tactical_move(ChessBoard *board, const Move move);   // Check if tactical move
 
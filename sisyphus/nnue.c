@@ -0,0 +1,428 @@
+#include "nnue.h"
+#include "eval.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#define NNUE_ALIGN 64
+#define NO_SQ SQUARE_NB
+
+typedef struct {
+    int features;           // NNUE_HALFKP or NNUE_HALFKA
+    int hidden;             // Accumulator size per perspective
+    int pieces;             // Piece kinds per king square, 10 or 12
+    int16_t *ft_weights;    // Feature transformer, one row of hidden per input
+    int16_t *ft_bias;       // Feature transformer bias
+    int16_t *out_weights;   // Output layer, side to move half first
+    int32_t out_bias;       // Output layer bias
+} Network;
+
+// Piece changes of one move, a square is NO_SQ when the piece appears or
+// disappears
+typedef struct {
+    int count;
+    int piece[4];
+    int from[4];
+    int to[4];
+} DirtyPiece;
+
+typedef struct {
+    DirtyPiece dirty;           // Changes of the move leading to this entry
+    bool computed[COLOR_NB];    // Accumulator of each perspective up to date
+} NNUEState;
+
+struct NNUEStack {
+    int top;                            // Entry of the current position
+    int hidden;                         // Network size the stack was made for
+    NNUEState state[NNUE_STACK_SIZE];
+    int16_t *acc;                       // 2 * hidden values per entry
+};
+
+// Searches read these without locking, they only change under
+// eval_lock_idle()
+static Network net;
+static bool net_enabled = false;
+
+#define ACC(stack, index, persp)                                               \
+  ((stack)->acc + ((size_t)(index) * COLOR_NB + (persp)) * (size_t)(stack)->hidden)
+
+static void *aligned_calloc(size_t bytes) {
+    bytes = (bytes + NNUE_ALIGN - 1) / NNUE_ALIGN * NNUE_ALIGN;
+    void *ptr = aligned_alloc(NNUE_ALIGN, bytes);
+    if (ptr != NULL)
+        memset(ptr, 0, bytes);
+    return ptr;
+}
+
+// The file is little endian like every target we build for, arrays are read
+// in place
+static bool read_array(FILE *file, void *dst, size_t size, size_t count) {
+    return fread(dst, size, count, file) == count;
+}
+
+// Caller holds the eval lock
+static void release_network(void) {
+    free(net.ft_weights);
+    free(net.ft_bias);
+    free(net.out_weights);
+    memset(&net, 0, sizeof(Network));
+    net_enabled = false;
+}
+
+int nnue_load(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        err("nnue_load(): could not open the network file");
+        return 0;
+    }
+
+    char magic[8];
+    uint32_t header[2];
+    if (!read_array(file, magic, 1, sizeof(magic)) ||
+            memcmp(magic, NNUE_MAGIC, sizeof(magic)) != 0 ||
+            !read_array(file, header, sizeof(uint32_t), 2) ||
+            header[0] > NNUE_HALFKA || header[1] == 0 || header[1] % 16 != 0 ||
+            header[1] > NNUE_MAX_HIDDEN) {
+        err("nnue_load(): not a supported network file");
+        fclose(file);
+        return 0;
+    }
+
+    Network loaded = {.features = (int)header[0], .hidden = (int)header[1]};
+    loaded.pieces = loaded.features == NNUE_HALFKA ? 12 : 10;
+    size_t inputs = (size_t)SQUARE_NB * loaded.pieces * SQUARE_NB;
+    size_t hidden = (size_t)loaded.hidden;
+
+    loaded.ft_weights = aligned_calloc(inputs * hidden * sizeof(int16_t));
+    loaded.ft_bias = aligned_calloc(hidden * sizeof(int16_t));
+    loaded.out_weights = aligned_calloc(2 * hidden * sizeof(int16_t));
+
+    bool ok = loaded.ft_weights && loaded.ft_bias && loaded.out_weights &&
+              read_array(file, loaded.ft_weights, sizeof(int16_t), inputs * hidden) &&
+              read_array(file, loaded.ft_bias, sizeof(int16_t), hidden) &&
+              read_array(file, loaded.out_weights, sizeof(int16_t), 2 * hidden) &&
+              read_array(file, &loaded.out_bias, sizeof(int32_t), 1) &&
+              fgetc(file) == EOF;
+    fclose(file);
+
+    if (!ok) {
+        err("nnue_load(): network file is truncated or too large");
+        free(loaded.ft_weights);
+        free(loaded.ft_bias);
+        free(loaded.out_weights);
+        return 0;
+    }
+
+    if (!eval_lock_idle()) {
+        err("nnue_load(): a search is running");
+        free(loaded.ft_weights);
+        free(loaded.ft_bias);
+        free(loaded.out_weights);
+        return 0;
+    }
+    release_network();
+    net = loaded;
+    net_enabled = true;
+    eval_unlock(true);
+    return 1;
+}
+
+int nnue_free(void) {
+    if (!eval_lock_idle()) {
+        err("nnue_free(): a search is running");
+        return 0;
+    }
+    bool changed = net_enabled;
+    release_network();
+    eval_unlock(changed);
+    return 1;
+}
+
+int nnue_set_enabled(bool enabled) {
+    if (!eval_lock_idle()) {
+        err("nnue_set_enabled(): a search is running");
+        return 0;
+    }
+    bool previous = net_enabled;
+    net_enabled = enabled && net.ft_weights != NULL;
+    eval_unlock(net_enabled != previous);
+    return 1;
+}
+
+bool nnue_enabled(void) {
+    return net_enabled;
+}
+
+const char *nnue_simd(void) {
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSE4_1__)
+    return "sse4.1";
+#else
+    return "scalar";
+#endif
+}
+
+NNUEStack *nnue_stack_new(void) {
+    NNUEStack *stack = calloc(1, sizeof(NNUEStack));
+    if (stack == NULL) {
+        err("nnue_stack_new(): failed to allocate the accumulator stack");
+        return NULL;
+    }
+
+    stack->hidden = net.hidden > 0 ? net.hidden : 16;
+    stack->acc = aligned_calloc((size_t)NNUE_STACK_SIZE * COLOR_NB * stack->hidden *
+                                sizeof(int16_t));
+    if (stack->acc == NULL) {
+        err("nnue_stack_new(): failed to allocate the accumulators");
+        free(stack);
+        return NULL;
+    }
+    return stack;
+}
+
+void nnue_stack_free(NNUEStack *stack) {
+    if (stack == NULL)
+        return;
+    free(stack->acc);
+    free(stack);
+}
+
+INLINE void add_dirty(DirtyPiece *dirty, int piece, int from, int to) {
+    dirty->piece[dirty->count] = piece;
+    dirty->from[dirty->count] = from;
+    dirty->to[dirty->count] = to;
+    dirty->count++;
+}
+
+void nnue_push(NNUEStack *stack, Move move, int capture) {
+    int src = EXTRACT_FROM(move);
+    int dst = EXTRACT_TO(move);
+    int piece = EXTRACT_PIECE(move);
+    int flag = EXTRACT_FLAGS(move);
+
+    ASSERT(stack->top + 1 < NNUE_STACK_SIZE);
+    NNUEState *state = &stack->state[++stack->top];
+    DirtyPiece *dirty = &state->dirty;
+    state->computed[WHITE] = state->computed[BLACK] = false;
+    dirty->count = 0;
+
+    if (IS_PROMO(flag)) {
+        add_dirty(dirty, piece, src, NO_SQ);
+        add_dirty(dirty, make_piece_type(PROMO_PT(flag), COLOR(piece)), NO_SQ, dst);
+    } else {
+        add_dirty(dirty, piece, src, dst);
+    }
+
+    if (capture != NONE)
+        add_dirty(dirty, capture, dst, NO_SQ);
+
+    // The captured pawn stands behind the destination, piece ^ 1 is its color
+    if (IS_ENP(flag))
+        add_dirty(dirty, piece ^ 1, COLOR(piece) == WHITE ? dst - 8 : dst + 8, NO_SQ);
+
+    if (IS_CAS(flag)) {
+        int rook = make_piece_type(ROOK, COLOR(piece));
+        int kingSide = dst > src;
+        add_dirty(dirty, rook, kingSide ? dst + 1 : dst - 2, kingSide ? dst - 1 : dst + 1);
+    }
+}
+
+void nnue_pop(NNUEStack *stack) {
+    ASSERT(stack->top > 0);
+    stack->top--;
+}
+
+// Kings are inputs of HalfKA only
+static INLINE bool is_feature(int piece) {
+    return net.features == NNUE_HALFKA || PIECE(piece) != KING;
+}
+
+static INLINE int feature_index(int persp, int king, int piece, int sq) {
+    // Black sees the board flipped, its pieces become "ours"
+    int flip = persp == WHITE ? 0 : 56;
+    int kind = PIECE(piece) * 2 + (COLOR(piece) != persp);
+    return ((king ^ flip) * net.pieces + kind) * SQUARE_NB + (sq ^ flip);
+}
+
+// dst = src + rows add - rows sub, dst may be src
+static void accumulate(int16_t *dst, const int16_t *src, const int *add, int addCount,
+                       const int *sub, int subCount) {
+    const size_t hidden = (size_t)net.hidden;
+
+#if defined(__AVX2__)
+    for (size_t i = 0; i < hidden; i += 16) {
+        __m256i v = _mm256_load_si256((const __m256i *)(src + i));
+        for (int a = 0; a < addCount; a++)
+            v = _mm256_add_epi16(v, _mm256_load_si256(
+                                     (const __m256i *)(net.ft_weights + add[a] * hidden + i)));
+        for (int s = 0; s < subCount; s++)
+            v = _mm256_sub_epi16(v, _mm256_load_si256(
+                                     (const __m256i *)(net.ft_weights + sub[s] * hidden + i)));
+        _mm256_store_si256((__m256i *)(dst + i), v);
+    }
+#elif defined(__SSE4_1__)
+    for (size_t i = 0; i < hidden; i += 8) {
+        __m128i v = _mm_load_si128((const __m128i *)(src + i));
+        for (int a = 0; a < addCount; a++)
+            v = _mm_add_epi16(v, _mm_load_si128(
+                                  (const __m128i *)(net.ft_weights + add[a] * hidden + i)));
+        for (int s = 0; s < subCount; s++)
+            v = _mm_sub_epi16(v, _mm_load_si128(
+                                  (const __m128i *)(net.ft_weights + sub[s] * hidden + i)));
+        _mm_store_si128((__m128i *)(dst + i), v);
+    }
+#else
+    for (size_t i = 0; i < hidden; i++) {
+        int16_t v = src[i];
+        for (int a = 0; a < addCount; a++)
+            v += net.ft_weights[add[a] * hidden + i];
+        for (int s = 0; s < subCount; s++)
+            v -= net.ft_weights[sub[s] * hidden + i];
+        dst[i] = v;
+    }
+#endif
+}
+
+static void refresh(ChessBoard *board, int persp, int16_t *acc) {
+    int king = get_lsb(board->bb_squares[WHITE_KING + persp]);
+    int features[32], count = 0, sq;
+
+    for (int piece = WHITE_PAWN; piece <= BLACK_KING; piece++) {
+        if (!is_feature(piece))
+            continue;
+
+        bb pieces = board->bb_squares[piece];
+        while (pieces && count < 32) {
+            POP_LSB(sq, pieces);
+            features[count++] = feature_index(persp, king, piece, sq);
+        }
+    }
+
+    accumulate(acc, net.ft_bias, features, count, NULL, 0);
+}
+
+INLINE bool king_moved(const DirtyPiece *dirty, int persp) {
+    for (int i = 0; i < dirty->count; i++) {
+        if (dirty->piece[i] == WHITE_KING + persp)
+            return true;
+    }
+    return false;
+}
+
+// Bring the accumulator of the current position up to date from the last
+// computed one, a move of our own king changes every input and forces a refresh
+static void update(NNUEStack *stack, ChessBoard *board, int persp) {
+    NNUEState *state = stack->state;
+    int top = stack->top, from = top;
+
+    while (from > 0 && !state[from].computed[persp] &&
+            !king_moved(&state[from].dirty, persp))
+        from--;
+
+    if (!state[from].computed[persp]) {
+        refresh(board, persp, ACC(stack, top, persp));
+        state[top].computed[persp] = true;
+        return;
+    }
+
+    int king = get_lsb(board->bb_squares[WHITE_KING + persp]);
+    for (int i = from + 1; i <= top; i++) {
+        const DirtyPiece *dirty = &state[i].dirty;
+        int add[4], sub[4], addCount = 0, subCount = 0;
+
+        for (int j = 0; j < dirty->count; j++) {
+            if (!is_feature(dirty->piece[j]))
+                continue;
+            if (dirty->from[j] != NO_SQ)
+                sub[subCount++] = feature_index(persp, king, dirty->piece[j], dirty->from[j]);
+            if (dirty->to[j] != NO_SQ)
+                add[addCount++] = feature_index(persp, king, dirty->piece[j], dirty->to[j]);
+        }
+
+        accumulate(ACC(stack, i, persp), ACC(stack, i - 1, persp), add, addCount, sub,
+                   subCount);
+        state[i].computed[persp] = true;
+    }
+}
+
+// Clipped ReLU of both accumulators dotted with the output weights
+static int32_t propagate(const int16_t *us, const int16_t *them) {
+    const int hidden = net.hidden;
+    const int16_t *weights = net.out_weights;
+
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i qa = _mm256_set1_epi16(NNUE_QA);
+    __m256i sum = _mm256_setzero_si256();
+
+    for (int i = 0; i < hidden; i += 16) {
+        __m256i x = _mm256_load_si256((const __m256i *)(us + i));
+        __m256i y = _mm256_load_si256((const __m256i *)(them + i));
+        x = _mm256_min_epi16(_mm256_max_epi16(x, zero), qa);
+        y = _mm256_min_epi16(_mm256_max_epi16(y, zero), qa);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(
+                                   x, _mm256_load_si256((const __m256i *)(weights + i))));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(
+                                   y, _mm256_load_si256((const __m256i *)(weights + hidden + i))));
+    }
+
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+    return _mm_cvtsi128_si32(s);
+#elif defined(__SSE4_1__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i qa = _mm_set1_epi16(NNUE_QA);
+    __m128i sum = _mm_setzero_si128();
+
+    for (int i = 0; i < hidden; i += 8) {
+        __m128i x = _mm_load_si128((const __m128i *)(us + i));
+        __m128i y = _mm_load_si128((const __m128i *)(them + i));
+        x = _mm_min_epi16(_mm_max_epi16(x, zero), qa);
+        y = _mm_min_epi16(_mm_max_epi16(y, zero), qa);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(x, _mm_load_si128((const __m128i *)(weights + i))));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(
+                                 y, _mm_load_si128((const __m128i *)(weights + hidden + i))));
+    }
+
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    for (int i = 0; i < hidden; i++) {
+        int x = us[i] < 0 ? 0 : us[i] > NNUE_QA ? NNUE_QA : us[i];
+        int y = them[i] < 0 ? 0 : them[i] > NNUE_QA ? NNUE_QA : them[i];
+        sum += x * weights[i] + y * weights[hidden + i];
+    }
+    return sum;
+#endif
+}
+
+static INLINE int scale_output(int32_t sum) {
+    return (int)(((int64_t)sum + net.out_bias) * NNUE_SCALE / (NNUE_QA * NNUE_QB));
+}
+
+int nnue_eval(ChessBoard *board) {
+    // Kingless test positions have no inputs for the network
+    if (!board->bb_squares[WHITE_KING] || !board->bb_squares[BLACK_KING])
+        return pesto_eval(board);
+
+    int us = board->color, them = board->color ^ 1;
+    NNUEStack *stack = board->nnue;
+
+    if (stack != NULL && stack->hidden == net.hidden) {
+        update(stack, board, WHITE);
+        update(stack, board, BLACK);
+        return scale_output(propagate(ACC(stack, stack->top, us), ACC(stack, stack->top, them)));
+    }
+
+    _Alignas(NNUE_ALIGN) int16_t acc[COLOR_NB][NNUE_MAX_HIDDEN];
+    refresh(board, WHITE, acc[WHITE]);
+    refresh(board, BLACK, acc[BLACK]);
+    return scale_output(propagate(acc[us], acc[them]));
+}
@@ -0,0 +1,65 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include "bb.h"
+#include "board.h"
+#include "move.h"
+#include "types.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+// Network file layout, little endian:
+//   char    magic[8]           "SISNNUE1"
+//   uint32  features           NNUE_HALFKP or NNUE_HALFKA
+//   uint32  hidden             Accumulator size per perspective, multiple of 16
+//   int16   ft_weights[inputs][hidden]
+//   int16   ft_bias[hidden]
+//   int16   out_weights[2 * hidden]  Side to move half first
+//   int32   out_bias
+// inputs is 64 king squares * 10 (HalfKP) or 12 (HalfKA) pieces * 64 squares.
+// Accumulators are clipped to [0, NNUE_QA], the output is scaled by
+// NNUE_SCALE / (NNUE_QA * NNUE_QB) to centipawns.
+#define NNUE_MAGIC "SISNNUE1"
+#define NNUE_HALFKP 0
+#define NNUE_HALFKA 1
+#define NNUE_MAX_HIDDEN 2048
+#define NNUE_QA 255
+#define NNUE_QB 64
+#define NNUE_SCALE 400
+#define NNUE_STACK_SIZE (MAX_PLY + 8) // Deeper than any search line
+
+// Load a network file, it replaces the current one and enables it. Fails
+// while a search is running.
+int nnue_load(const char *path);
+
+// Release the network, eval() falls back to PESTO. Fails while a search is
+// running.
+int nnue_free(void);
+
+// Select the network (true) or PESTO (false) for eval(), a no-op without a
+// network. Fails while a search is running.
+int nnue_set_enabled(bool enabled);
+
+// True when eval() uses the network
+bool nnue_enabled(void);
+
+// Name of the SIMD kernels compiled in
+const char *nnue_simd(void);
+
+// Allocate an accumulator stack for a search thread, NULL on failure
+NNUEStack *nnue_stack_new(void);
+
+// Free an accumulator stack
+void nnue_stack_free(NNUEStack *stack);
+
+// Record the piece changes of a move made on the board, called by do_move
+void nnue_push(NNUEStack *stack, Move move, int capture);
+
+// Drop the accumulator of the last move, called by undo_move
+void nnue_pop(NNUEStack *stack);
+
+// Network evaluation, side to move relative. Accumulators come from
+// board->nnue when set, otherwise they are rebuilt from scratch.
+int nnue_eval(ChessBoard *board);
+
+#endif // NNUE_H
@@ -0,0 +1,181 @@
+#include "picker.h"
+#include "search.h"
+
+void picker_init(MovePicker *picker, Thread_d *thread, ChessBoard *board,
+                 Move tt_move, int ply, bool noisy_only) {
+    picker->stage = STAGE_TT;
+    picker->noisy_only = noisy_only;
+    picker->thread = thread;
+    picker->board = board;
+    picker->count = picker->index = picker->bad_count = 0;
+    picker->tt_move = NULL_MOVE;
+    picker->killers[0] = picker->killers[1] = NULL_MOVE;
+
+    // Every evasion is searched when in check, quiescence included
+    if (board->checkers) {
+        picker->stage = STAGE_EVASION_TT;
+        if (is_legal(board, tt_move))
+            picker->tt_move = tt_move;
+        return;
+    }
+
+    if (noisy_only)
+        return;
+
+    // The table move may come from a colliding position, validate it before
+    // playing it instead of generating anything
+    if (is_pseudo_legal(board, tt_move))
+        picker->tt_move = tt_move;
+
+    picker->killers[0] = thread->killers[WHITE][ply];
+    if (thread->killers[BLACK][ply] != picker->killers[0])
+        picker->killers[1] = thread->killers[BLACK][ply];
+}
+
+// Selection sort step: bring the best remaining move to the front
+INLINE Move picker_select(MovePicker *picker) {
+    if (picker->index >= picker->count)
+        return NULL_MOVE;
+
+    int best = picker->index;
+    for (int i = picker->index + 1; i < picker->count; i++) {
+        if (picker->scores[i] > picker->scores[best])
+            best = i;
+    }
+
+    Move move = picker->moves[best];
+    int score = picker->scores[best];
+    picker->moves[best] = picker->moves[picker->index];
+    picker->scores[best] = picker->scores[picker->index];
+    picker->moves[picker->index] = move;
+    picker->scores[picker->index] = score;
+
+    return picker->moves[picker->index++];
+}
+
+Move picker_next(MovePicker *picker) {
+    ChessBoard *board = picker->board;
+    Move move;
+
+    switch (picker->stage) {
+    case STAGE_TT:
+        picker->stage = STAGE_GEN_NOISY;
+        if (picker->tt_move != NULL_MOVE)
+            return picker->tt_move;
+    // fall through
+    case STAGE_GEN_NOISY:
+        picker->count = gen_noisy_moves(board, picker->moves);
+        picker->index = 0;
+        for (int i = 0; i < picker->count; i++) {
+            score_moves(board, picker->moves[i], &picker->scores[i]);
+        }
+        picker->stage = STAGE_GOOD_NOISY;
+    // fall through
+    case STAGE_GOOD_NOISY:
+        while ((move = picker_select(picker)) != NULL_MOVE) {
+            if (move == picker->tt_move)
+                continue;
+            if (!staticExchangeEvaluation(board, move, 0)) {
+                picker->bad[picker->bad_count++] = move;
+                continue;
+            }
+            return move;
+        }
+
+        // Quiescence only looks at captures that do not lose material
+        if (picker->noisy_only) {
+            picker->stage = STAGE_DONE;
+            return NULL_MOVE;
+        }
+
+        picker->index = 0;
+        picker->stage = STAGE_KILLERS;
+    // fall through
+    case STAGE_KILLERS:
+        while (picker->index < 2) {
+            move = picker->killers[picker->index++];
+            if (move != NULL_MOVE && move != picker->tt_move &&
+                    !is_tactical_move(board, move) && is_pseudo_legal(board, move))
+                return move;
+        }
+        picker->stage = STAGE_GEN_QUIET;
+    // fall through
+    case STAGE_GEN_QUIET: {
+        int (*history)[SQUARE_NB] = picker->thread->history[board->color];
+
+        picker->count = gen_quiet_moves(board, picker->moves);
+        picker->index = 0;
+        for (int i = 0; i < picker->count; i++) {
+            move = picker->moves[i];
+            score_moves(board, move, &picker->scores[i]);
+            picker->scores[i] += history[EXTRACT_FROM(move)][EXTRACT_TO(move)];
+        }
+        picker->stage = STAGE_QUIET;
+    }
+    // fall through
+    case STAGE_QUIET:
+        while ((move = picker_select(picker)) != NULL_MOVE) {
+            if (move != picker->tt_move && move != picker->killers[0] &&
+                    move != picker->killers[1])
+                return move;
+        }
+        picker->index = 0;
+        picker->stage = STAGE_BAD_NOISY;
+    // fall through
+    case STAGE_BAD_NOISY:
+        if (picker->index < picker->bad_count)
+            return picker->bad[picker->index++];
+        picker->stage = STAGE_DONE;
+        return NULL_MOVE;
+    case STAGE_EVASION_TT:
+        picker->stage = STAGE_GEN_EVASIONS;
+        if (picker->tt_move != NULL_MOVE)
+            return picker->tt_move;
+    // fall through
+    case STAGE_GEN_EVASIONS: {
+        int (*history)[SQUARE_NB] = picker->thread->history[board->color];
+
+        // Captures of the checker first, then the rest by history
+        picker->count = gen_evasions(board, picker->moves);
+        picker->index = 0;
+        for (int i = 0; i < picker->count; i++) {
+            move = picker->moves[i];
+            score_moves(board, move, &picker->scores[i]);
+            if (!is_tactical_move(board, move))
+                picker->scores[i] += history[EXTRACT_FROM(move)][EXTRACT_TO(move)];
+        }
+        picker->stage = STAGE_EVASIONS;
+    }
+    // fall through
+    case STAGE_EVASIONS:
+        while ((move = picker_select(picker)) != NULL_MOVE) {
+            if (move != picker->tt_move)
+                return move;
+        }
+        picker->stage = STAGE_DONE;
+    // fall through
+    default:
+        return NULL_MOVE;
+    }
+}
+
+int picker_moves(ChessBoard *board, Move tt_move, const Move *killers, Move *moves) {
+    Thread_d *thread = (Thread_d *)calloc(1, sizeof(Thread_d));
+    MovePicker picker;
+    Move move;
+    int count = 0;
+
+    if (thread == NULL) {
+        err("picker_moves(): Could not allocate memory for thread");
+        return 0;
+    }
+
+    thread->killers[WHITE][0] = killers[0];
+    thread->killers[BLACK][0] = killers[1];
+    picker_init(&picker, thread, board, tt_move, 0, false);
+    while (count < MAX_MOVES && (move = picker_next(&picker)) != NULL_MOVE)
+        moves[count++] = move;
+
+    free(thread);
+    return count;
+}
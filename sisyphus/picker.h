@@ -0,0 +1,48 @@
+#ifndef PICKER_H
+#define PICKER_H
+
+#include "gen.h"
+#include "move.h"
+#include "types.h"
+#include <stdbool.h>
+
+// Move picker stages, each one is only generated once the previous is exhausted
+#define STAGE_TT 0          // Transposition table move
+#define STAGE_GEN_NOISY 1   // Generate and score captures and promotions
+#define STAGE_GOOD_NOISY 2  // Captures that do not lose material
+#define STAGE_KILLERS 3     // Killer moves
+#define STAGE_GEN_QUIET 4   // Generate and score quiet moves
+#define STAGE_QUIET 5       // Quiet moves by history
+#define STAGE_BAD_NOISY 6   // Captures losing material
+#define STAGE_EVASION_TT 7  // Transposition table move when in check
+#define STAGE_GEN_EVASIONS 8 // Generate and score check evasions
+#define STAGE_EVASIONS 9    // Check evasions by score
+#define STAGE_DONE 10
+
+typedef struct {
+    int stage;              // Current stage
+    bool noisy_only;        // Only captures and promotions (quiescence), unless in check
+    Thread_d *thread;       // Owner of the history table
+    ChessBoard *board;      // Position the moves are picked for
+    Move tt_move;           // Move from the transposition table
+    Move killers[2];        // Killer moves of the current ply
+    Move moves[MAX_MOVES];  // Moves of the current stage
+    int scores[MAX_MOVES];  // Ordering scores of the current stage
+    int count;              // Number of moves of the current stage
+    int index;              // Next move to pick
+    Move bad[MAX_MOVES];    // Captures deferred to the last stage
+    int bad_count;          // Number of deferred captures
+} MovePicker;
+
+// Prepare the picker, nothing is generated until picker_next() is called
+void picker_init(MovePicker *picker, Thread_d *thread, ChessBoard *board,
+                 Move tt_move, int ply, bool noisy_only);
+
+// Next pseudo-legal move in ordering, NULL_MOVE once every move was returned
+Move picker_next(MovePicker *picker);
+
+// Drain a fresh picker with the given table move and two killers into moves,
+// returns the number of moves. Used to test the stages.
+int picker_moves(ChessBoard *board, Move tt_move, const Move *killers, Move *moves);
+
+#endif // PICKER_H
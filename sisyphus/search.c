@@ -1,87 +1,124 @@
 #include "search.h"
-#include "utils.h"
+#include <inttypes.h>
 
 #define FullDepthMoves 5
 #define ReductionLimit 3
-#define MAX_PLY 100
 
-void sort_moves(Search *search, ChessBoard *board, Move *moves, int count,
-                int ply) {
-    Move temp[MAX_MOVES];
-    int scores[MAX_MOVES];
-    int indexes[MAX_MOVES];
+// The main thread checks the node limit and polls the clock, helpers stop
+// with it
+INLINE void check_limits(Thread_d *thread) {
+    Search *search = thread->search;
 
-    Move best = table_get_move(&search->table, board->hash);
-    for (int i = 0; i < count; i++) {
-        Move move = moves[i];
-        score_moves(board, move, &scores[i]);
-        if (!is_capture(board, move)) {
-            if (best != NULL_MOVE && (best == move))
-                scores[i] += INF;
-            else if (KILLER_MOVES[WHITE][ply] == move)
-                scores[i] += 9000;
-            else if (KILLER_MOVES[BLACK][ply] == move)
-                scores[i] += 8000;
-            else
-                scores[i] +=
-                    History_Heuristic[board->color][EXTRACT_FROM(move)][EXTRACT_TO(move)];
-        }
-        indexes[i] = i;
-    }
+    if (thread->id != 0)
+        return;
 
-    for (int i = 1; i < count; i++) {
-        int j = i;
-        while (j > 0 && scores[j - 1] < scores[j]) {
-            swap_any(&scores[j - 1], &scores[j], sizeof(int));
-            swap_any(&indexes[j - 1], &indexes[j], sizeof(int));
-            j--;
-        }
-    }
+    if (search->limits.nodes && thread->nodes >= search->limits.nodes)
+        search->stop = true;
 
-    memcpy(temp, moves, sizeof(Move) * count);
+    if ((thread->nodes & TIME_CHECK_MASK) == 0 && !search->ponder &&
+            time_over(&search->tm))
+        search->stop = true;
+}
 
-    for (int i = 0; i < count; i++) {
-        moves[i] = temp[indexes[i]];
+// The move of the previous iteration's PV while on its path, the table move
+// otherwise. Collisions may have replaced the PV in the table.
+INLINE Move pv_move(Thread_d *thread, ChessBoard *board, int ply) {
+    const PVLine *line = &thread->lines[thread->pv_index];
+
+    if (thread->follow_pv && ply < line->pv_length)
+        return line->pv[ply];
+
+    thread->follow_pv = false;
+    return table_get_move(&thread->search->table, board);
+}
+
+// A new best move at ply, its PV continues with the one of the child
+INLINE void update_pv(Thread_d *thread, int ply, Move move) {
+    thread->pv[ply][0] = move;
+    memcpy(&thread->pv[ply][1], thread->pv[ply + 1],
+           thread->pv_length[ply + 1] * sizeof(Move));
+    thread->pv_length[ply] = thread->pv_length[ply + 1] + 1;
+}
+
+// Static evaluation through the caches. Main search nodes also look in the
+// transposition table and leave the result there, quiescence nodes only use
+// the thread's own cache, a table probe costs more than it saves there.
+INLINE int static_eval(Thread_d *thread, ChessBoard *board, bool useTable) {
+    Table *table = &thread->search->table;
+    int value;
+
+    thread->eval_probes++;
+    if (useTable && table_get_eval(table, board->hash, &value)) {
+        thread->tt_eval_hits++;
+        return value;
     }
+
+    if (eval_table_get(&thread->eval_table, board->hash, &value)) {
+        thread->eval_hits++;
+    } else {
+        value = eval(board);
+        eval_table_set(&thread->eval_table, board->hash, value);
+    }
+
+    if (useTable)
+        table_set_eval(table, board->hash, value);
+    return value;
 }
 
-int ok_to_reduce(ChessBoard *board, Move move) {
+int ok_to_reduce(ChessBoard *board, Move move, int givesCheck) {
     // https://www.chessprogramming.org/Late_Move_Reductions#Uncommon_Conditions
-    return ((!is_tactical_move(board, move)) && (!move_gives_check(board, move)));
+    return ((!is_tactical_move(board, move)) && (!givesCheck));
 }
 
-int quiescence_search(Search *search, ChessBoard *board, int ply, int alpha,
+int quiescence_search(Thread_d *thread, ChessBoard *board, int ply, int alpha,
                       int beta) {
-    int score, count;
+    Search *search = thread->search;
+    int score, can_move = 0;
     Undo undo;
-    Move moves[MAX_MOVES];
+    MovePicker picker;
+    Move move;
+    const int InCheck = is_check(board);
 
-    score = eval(board);
+    if (ply > thread->seldepth)
+        thread->seldepth = ply;
 
-    if (score >= beta) {
-        return beta;
-    }
+    if (ply >= MAX_PLY)
+        return InCheck ? 0 : eval(board);
 
-    // https://www.chessprogramming.org/Delta_Pruning
-    int Delta = 975; // queen value
-    if (score + Delta < alpha) {
-        return alpha;
-    }
+    // No standing pat in check, every evasion is searched instead
+    if (!InCheck) {
+        score = static_eval(thread, board, false);
+
+        if (score >= beta) {
+            return beta;
+        }
 
-    alpha = MAX(alpha, score);
+        // https://www.chessprogramming.org/Delta_Pruning
+        int Delta = 975; // queen value
+        if (score + Delta < alpha) {
+            return alpha;
+        }
 
-    count = gen_attacks(board, moves);
-    sort_moves(search, board, moves, count, ply);
+        alpha = MAX(alpha, score);
+    }
 
-    for (int i = 0; i < count; i++) {
-        Move move = moves[i];
+    picker_init(&picker, thread, board, NULL_MOVE, ply, true);
 
-        if (!staticExchangeEvaluation(board, move, 0))
+    while ((move = picker_next(&picker)) != NULL_MOVE) {
+        // Once mate is ruled out only captures are tried against the check
+        if (can_move && !is_tactical_move(board, move))
             continue;
-        search->nodes++;
+
         do_move(board, move, &undo);
-        int value = -quiescence_search(search, board, ply + 1, -beta, -alpha);
+        if (illegal_to_move(board)) {
+            undo_move(board, move, &undo);
+            continue;
+        }
+        thread->nodes++;
+        check_limits(thread);
+        int value = -quiescence_search(thread, board, ply + 1, -beta, -alpha);
         undo_move(board, move, &undo);
+        can_move = 1;
 
         if (search->stop) {
             alpha = 0;
@@ -95,21 +132,31 @@ int quiescence_search(Search *search, ChessBoard *board, int ply, int alpha,
         alpha = MAX(alpha, value);
     }
 
+    if (InCheck && !can_move)
+        return -MATE + ply;
+
 stop_loop:
     return alpha;
 }
 
-int negamax(Search *search, ChessBoard *board, int depth, int ply, int alpha,
+int negamax(Thread_d *thread, ChessBoard *board, int depth, int ply, int alpha,
             int beta, bool cutnode) {
-    int flag = ALPHA, value = -INF, count, TtHit, can_move = 0,
+    Search *search = thread->search;
+    int flag = ALPHA, value = -INF, TtHit, can_move = 0,
         moves_searched = 0;
     const int isPv = (alpha != beta - 1);
     const int isRootN = (ply != 0);
     const int InCheck = is_check(board);
     Undo undo;
-    Move moves[MAX_MOVES];
+    MovePicker picker;
+    CheckInfo ci;
+    Move move, best = NULL_MOVE;
 
     depth = MAX(depth, 0); // Make sure depth >= 0
+    thread->pv_length[ply] = 0;
+
+    if (ply > thread->seldepth)
+        thread->seldepth = ply;
 
     if (!isRootN) {
         if (is_draw(board, ply))
@@ -122,25 +169,26 @@ int negamax(Search *search, ChessBoard *board, int depth, int ply, int alpha,
             return rAlpha;
     }
 
-    if ((TtHit = table_get(&search->table, board->hash, depth, alpha, beta,
-                           &value))) {
+    // No cutoffs in PV nodes, they would truncate the PV
+    if (!isPv && (TtHit = table_get(&search->table, board->hash, depth, alpha,
+                                    beta, &value))) {
         return value;
     }
 
     // https://www.chessprogramming.org/Internal_Iterative_Reductions
     if (!InCheck) {
-        Entry *entry = table_entry(&search->table, board->hash);
-        if ((isPv || cutnode) && depth >= 4 && entry->move == NULL_MOVE)
+        if ((isPv || cutnode) && depth >= 4 &&
+                table_get_move(&search->table, board) == NULL_MOVE)
             depth--;
     }
 
     if (depth == 0 && !InCheck) {
-        value = quiescence_search(search, board, ply, alpha, beta);
-        table_set(&search->table, board->hash, depth, value, EXACT);
+        value = quiescence_search(thread, board, ply, alpha, beta);
+        table_set(&search->table, board->hash, depth, value, EXACT, NULL_MOVE);
         return value;
     }
 
-    value = eval(board);
+    value = static_eval(thread, board, true);
 
     // Reverse Futility Pruning
     if (!InCheck && !isPv && depth <= 3) {
@@ -153,7 +201,7 @@ int negamax(Search *search, ChessBoard *board, int depth, int ply, int alpha,
     // Razoring
     if (!InCheck && !isPv) {
         if (depth <= 5 && value + 214 * depth <= alpha) {
-            int score = quiescence_search(search, board, ply, alpha, beta);
+            int score = quiescence_search(thread, board, ply, alpha, beta);
             if (score <= alpha)
                 return score;
         }
@@ -163,44 +211,55 @@ int negamax(Search *search, ChessBoard *board, int depth, int ply, int alpha,
     if (!InCheck && !isPv && depth >= 3) {
         do_null_move_pruning(board, &undo);
         int R = depth > 6 ? MAX_R : MIN_R;
-        int score = -negamax(search, board, depth - R - 1, ply + 1, -beta,
+        int score = -negamax(thread, board, depth - R - 1, ply + 1, -beta,
                              -beta + 1, !cutnode);
         undo_null_move_pruning(board, &undo);
         if (score >= beta) {
             depth -= DR;
             if (depth <= 0)
-                return quiescence_search(search, board, ply, alpha, beta);
-            table_set(&search->table, board->hash, depth, beta, BETA);
+                return quiescence_search(thread, board, ply, alpha, beta);
+            table_set(&search->table, board->hash, depth, beta, BETA, NULL_MOVE);
             return beta;
         }
     }
 
-    count = gen_legal_moves(board, moves);
-    sort_moves(search, board, moves, count, ply);
+    picker_init(&picker, thread, board, pv_move(thread, board, ply), ply, false);
+    check_info_init(board, &ci);
+
+    while ((move = picker_next(&picker)) != NULL_MOVE) {
+        // Reductions are decided on the position before the move
+        const int reduce = moves_searched >= FullDepthMoves &&
+                           depth >= ReductionLimit && !isPv &&
+                           ok_to_reduce(board, move, gives_check(board, &ci, move)) &&
+                           !staticExchangeEvaluation(board, move, 0) &&
+                           thread->killers[board->color][ply] != move;
 
-    for (int i = 0; i < count; i++) {
-        Move move = moves[i];
         do_move(board, move, &undo);
+        if (illegal_to_move(board)) {
+            undo_move(board, move, &undo);
+            continue;
+        }
+        thread->nodes++;
+        check_limits(thread);
+
         if (moves_searched == 0) {
             value =
-                -negamax(search, board, depth - 1, ply + 1, -beta, -alpha, !cutnode);
+                -negamax(thread, board, depth - 1, ply + 1, -beta, -alpha, !cutnode);
+            // The rest of the previous PV was below the first move
+            thread->follow_pv = false;
         } else {
-            if (moves_searched >= FullDepthMoves && depth >= ReductionLimit &&
-                    !isPv && !is_check(board) &&
-                    !staticExchangeEvaluation(board, move, 0) &&
-                    ok_to_reduce(board, move) &&
-                    KILLER_MOVES[board->color][ply] != move) {
-                value = -negamax(search, board, depth - 2, ply + 1, -alpha - 1, -alpha,
+            if (reduce) {
+                value = -negamax(thread, board, depth - 2, ply + 1, -alpha - 1, -alpha,
                                  true);
             } else {
                 value = alpha + 1;
             }
 
             if (value > alpha) {
-                value = -negamax(search, board, depth - 1, ply + 1, -alpha - 1, -alpha,
+                value = -negamax(thread, board, depth - 1, ply + 1, -alpha - 1, -alpha,
                                  !cutnode);
                 if (value > alpha && value < beta) {
-                    value = -negamax(search, board, depth - 1, ply + 1, -beta, -alpha,
+                    value = -negamax(thread, board, depth - 1, ply + 1, -beta, -alpha,
                                      !cutnode);
                 }
             }
@@ -220,29 +279,29 @@ int negamax(Search *search, ChessBoard *board, int depth, int ply, int alpha,
         if (value >= beta) {
             // Store Killer moves
             if (!is_capture(board, move)) {
-                KILLER_MOVES[BLACK][ply] = KILLER_MOVES[WHITE][ply];
-                KILLER_MOVES[WHITE][ply] = move;
+                thread->killers[BLACK][ply] = thread->killers[WHITE][ply];
+                thread->killers[WHITE][ply] = move;
             }
-            table_set(&search->table, board->hash, depth, beta, BETA);
-            table_set_move(&search->table, board->hash, depth, move);
+            table_set(&search->table, board->hash, depth, beta, BETA, move);
             return beta;
         }
 
         if (value > alpha) {
             if (!is_capture(board, move)) {
-                History_Heuristic[board->color][EXTRACT_FROM(move)][EXTRACT_TO(move)] +=
+                thread->history[board->color][EXTRACT_FROM(move)][EXTRACT_TO(move)] +=
                     depth * depth;
             }
             flag = EXACT;
             alpha = value;
-            table_set_move(&search->table, board->hash, depth, move);
+            best = move;
+            update_pv(thread, ply, move);
         }
     }
 
     if (!can_move)
         return is_check(board) ? -MATE + ply : 0;
 
-    table_set(&search->table, board->hash, depth, alpha, flag);
+    table_set(&search->table, board->hash, depth, alpha, flag, best);
 
 stop_loop:
     return alpha;
@@ -324,21 +383,116 @@ int staticExchangeEvaluation(ChessBoard *board, Move move, int threshold) {
     return result;
 }
 
-int root_search(Search *search, ChessBoard *board, int depth, int alpha,
+static void print_info(const SearchInfo *info, void *data) {
+    char str[MOVE_STR_SIZE];
+    (void)data;
+
+    if (info->currmove != NULL_MOVE) {
+        printf("info depth %d currmove %s currmovenumber %d\n", info->depth,
+               move_to_str(info->currmove, str), info->currmovenumber);
+        return;
+    }
+
+    printf("info depth %d seldepth %d multipv %d score cp %d nodes %" PRIu64
+           " nps %" PRIu64 " time %d hashfull %d pv", info->depth, info->seldepth,
+           info->multipv, info->score, info->nodes, info->nps, info->time,
+           info->hashfull);
+    for (int i = 0; i < info->pv_length; i++) {
+        printf(" %s", move_to_str(info->pv[i], str));
+    }
+    printf("\n");
+}
+
+// Report progress of the main thread, a NULL line is a current move report
+static void report_info(Thread_d *thread, const PVLine *line, int multipv,
+                        Move currmove, int currmovenumber) {
+    Search *search = thread->search;
+    InfoCallback callback = search->info ? search->info
+                            : thread->debug ? print_info : NULL;
+    SearchInfo info = {0};
+
+    if (callback == NULL)
+        return;
+
+    info.time = time_elapsed(&search->tm);
+    info.nodes = search->job ? search_nodes(search) : thread->nodes;
+    info.nps = info.nodes * 1000 / (uint64_t)(info.time > 0 ? info.time : 1);
+
+    info.seldepth = thread->seldepth;
+    if (line == NULL) {
+        // Current move reports describe the iteration in progress
+        info.depth = thread->depth + 1;
+        info.currmove = currmove;
+        info.currmovenumber = currmovenumber;
+    } else {
+        info.depth = line->depth;
+        info.multipv = multipv;
+        info.score = line->score;
+        info.hashfull = search_hashfull(search);
+        info.pv_length = line->pv_length;
+        memcpy(info.pv, line->pv, line->pv_length * sizeof(Move));
+    }
+
+    callback(&info, search->info_data);
+}
+
+// Moves of earlier lines of this iteration and moves outside searchmoves are
+// not searched at the root
+static bool root_excluded(Thread_d *thread, Move move) {
+    Search *search = thread->search;
+
+    for (int i = 0; i < thread->pv_index; i++) {
+        if (thread->lines[i].pv[0] == move)
+            return true;
+    }
+
+    if (search->searchmoves_count == 0)
+        return false;
+
+    for (int i = 0; i < search->searchmoves_count; i++) {
+        if (search->searchmoves[i] == move)
+            return false;
+    }
+
+    return true;
+}
+
+int root_search(Thread_d *thread, ChessBoard *board, int depth, int alpha,
                 int beta, Move *result) {
-    Move best_move = NULL_MOVE;
-    Move moves[MAX_MOVES];
+    Search *search = thread->search;
+    Move best_move = NULL_MOVE, move;
+    MovePicker picker;
     Undo undo;
-    int count = gen_legal_moves(board, moves), can_move = 0;
-    sort_moves(search, board, moves, count, 1);
+    int can_move = 0, number = 0;
 
-    for (int i = 0; i < count; i++) {
-        Move move = moves[i];
+    thread->pv_length[0] = 0;
+    thread->follow_pv = thread->pv_index < thread->line_count;
+    picker_init(&picker, thread, board, pv_move(thread, board, 0), 0, false);
+
+    while ((move = picker_next(&picker)) != NULL_MOVE) {
+        if (root_excluded(thread, move))
+            continue;
 
-        search->nodes++;
         do_move(board, move, &undo);
-        int score = -negamax(search, board, depth - 1, 1, -beta, -alpha, false);
+        if (illegal_to_move(board)) {
+            undo_move(board, move, &undo);
+            continue;
+        }
+
+        number++;
+        if (thread->id == 0 && search->info_interval > 0) {
+            int elapsed = time_elapsed(&search->tm);
+            if (elapsed - search->info_last >= search->info_interval) {
+                search->info_last = elapsed;
+                report_info(thread, NULL, 0, move, number);
+            }
+        }
+
+        thread->nodes++;
+        check_limits(thread);
+        int score = -negamax(thread, board, depth - 1, 1, -beta, -alpha, false);
         undo_move(board, move, &undo);
+        thread->follow_pv = false;
 
         if (search->stop) {
             alpha = 0;
@@ -349,80 +503,266 @@ int root_search(Search *search, ChessBoard *board, int depth, int alpha,
             alpha = score;
             best_move = move;
             can_move = 1;
+            update_pv(thread, 0, move);
         }
     }
 
 stop_loop:
     if (can_move) {
         *result = best_move;
-        table_set_move(&search->table, board->hash, depth, best_move);
+        // Only the first line holds the best move of the position
+        if (thread->pv_index == 0)
+            table_set_move(&search->table, board->hash, depth, best_move);
     }
     return alpha;
 }
 
-void print_pv(Search *search, ChessBoard *board, int depth) {
-    if (depth <= 0)
-        return;
+// Search the root for the current line, the aspiration window is centered on
+// the score the line had in the previous iteration
+static int search_line(Thread_d *thread, int depth, Move *move) {
+    PVLine *line = &thread->lines[thread->pv_index];
+    int alpha = -INF, beta = INF, score;
 
-    Entry *entry = table_entry(&search->table, board->hash);
+    if (thread->pv_index < thread->line_count) {
+        alpha = line->score - VALID_WINDOW;
+        beta = line->score + VALID_WINDOW;
+    }
 
-    if (entry->key != board->hash)
-        return;
+    while (true) {
+        *move = NULL_MOVE;
+        score = root_search(thread, &thread->board, depth, alpha, beta, move);
 
-    Move move = entry->move;
-    Undo undo;
+        // Aspiration window https://www.frayn.net/beowulf/theory.html#aspiration
+        // On a fail the same depth is searched again with a full window, so
+        // a depth limited search always completes its last iteration.
+        if ((score <= alpha || score >= beta) && (alpha > -INF || beta < INF) &&
+                !thread->search->stop) {
+            alpha = -INF;
+            beta = INF;
+            continue;
+        }
 
-    if (move != NULL_MOVE) {
-        printf(" %s", move_to_str(move));
-        do_move(board, move, &undo);
-        print_pv(search, board, depth - 1);
-        undo_move(board, move, &undo);
+        return score;
     }
 }
 
-int best_move(Search *search, ChessBoard *board, Move *result, bool debug) {
+int iterative_deepening(Thread_d *thread) {
+    Search *search = thread->search;
     int best_score = -INF;
-    int alpha = -INF, beta = INF;
-    search->stop = false;
 
-    if (!table_alloc(&search->table, 20)) {
-        return -best_score;
-    }
+    memset(thread->history, 0, sizeof(thread->history));
+    memset(thread->killers, 0, sizeof(thread->killers));
+    thread->line_count = 0;
 
-    memset(History_Heuristic, 0, sizeof(History_Heuristic));
+    // Only the main thread reports lines, helpers feed the table with one
+    int multipv = thread->id == 0 ? search->multipv : 1;
+    multipv = multipv < 1 ? 1 : multipv > MAX_MULTIPV ? MAX_MULTIPV : multipv;
 
-    for (int depth = 1; depth <= MAX_DEPTH; depth++) {
-        best_score = root_search(search, board, depth, alpha, beta, result);
+    // Lazy SMP: helpers with an odd id skip the first iteration so that the
+    // threads desynchronize and fill the shared table with different subtrees.
+    int max_depth = search->limits.depth > 0 && search->limits.depth < MAX_DEPTH
+                    ? search->limits.depth : MAX_DEPTH;
 
-        // Aspiration window https://www.frayn.net/beowulf/theory.html#aspiration
-        if ((best_score <= alpha) || (best_score >= beta)) {
-            alpha = -INF;
-            beta = INF;
-            continue;
+    // A mate in N moves is found by a depth 2N - 1 search, any mate ends the
+    // iterations below
+    if (search->limits.mate > 0 && 2 * search->limits.mate - 1 < max_depth)
+        max_depth = 2 * search->limits.mate - 1;
+
+    for (int depth = 1 + (thread->id & 1); depth <= max_depth; depth++) {
+        int count = 0;
+
+        for (thread->pv_index = 0; thread->pv_index < multipv; thread->pv_index++) {
+            PVLine *line = &thread->lines[thread->pv_index];
+            Move move;
+            int score = search_line(thread, depth, &move);
+
+            if (search->stop) {
+                // A move that beat the previous best before the stop is kept
+                if (thread->pv_index == 0 && move != NULL_MOVE)
+                    thread->move = move;
+                break;
+            }
+
+            // Fewer legal root moves than lines
+            if (move == NULL_MOVE)
+                break;
+
+            line->score = score;
+            line->depth = depth;
+            line->pv_length = thread->pv_length[0];
+            memcpy(line->pv, thread->pv[0], line->pv_length * sizeof(Move));
+            count++;
         }
 
-        alpha = best_score - VALID_WINDOW;
-        beta = best_score + VALID_WINDOW;
+        if (search->stop)
+            break;
 
-        if (debug) {
-            printf("info score=%d, depth=%d, pv ", best_score, depth);
-            print_pv(search, board, depth);
-            printf("\n");
+        // Order the lines by score, a later line can beat an earlier one
+        for (int i = 1; i < count; i++) {
+            PVLine line = thread->lines[i];
+            int j = i - 1;
+            for (; j >= 0 && thread->lines[j].score < line.score; j--) {
+                thread->lines[j + 1] = thread->lines[j];
+            }
+            thread->lines[j + 1] = line;
         }
-        
+
+        thread->line_count = count;
+        best_score = count ? thread->lines[0].score : -INF;
+        if (count)
+            thread->move = thread->lines[0].pv[0];
+
+        thread->depth = depth;
+        if (thread->id == 0) {
+            search->depth = depth;
+            memcpy(search->lines, thread->lines, count * sizeof(PVLine));
+            search->line_count = count;
+
+            for (int i = 0; i < count; i++) {
+                report_info(thread, &thread->lines[i], i + 1, NULL_MOVE, 0);
+            }
+        }
+        thread->seldepth = 0;
+
         if (best_score == -INF) {
             best_score = 0;
-            goto cleanup;
+            break;
         }
 
-        if (search->stop)
-            goto cleanup;
-
         if (best_score >= MATE - depth || best_score <= -MATE + depth)
-            goto cleanup;
+            break;
+
+        // While pondering the stability is tracked but the clock is not
+        if (thread->id == 0 &&
+                time_stop_iteration(&search->tm, thread->move, best_score) &&
+                !search->ponder)
+            break;
+    }
+
+    return best_score;
+}
+
+int search_init(Search *search) {
+    search->stop = false;
+    search->depth = 0;
+    search->nodes = 0;
+    search->info_last = 0;
+    search->line_count = 0;
+
+    if (search->table.bucket == NULL &&
+            !table_alloc(&search->table, search->hash_mb ? search->hash_mb
+                         : DEFAULT_HASH_MB))
+        return 0;
+
+    table_new_search(&search->table);
+    return 1;
+}
+
+void search_clear(Search *search) {
+    table_clear(&search->table);
+    search->eval_probes = search->eval_hits = search->tt_eval_hits = 0;
+}
+
+void search_free(Search *search) {
+    if (search->job != NULL) {
+        thread_stop(search);
+        search_wait(search);
     }
 
-cleanup:
     table_free(&search->table);
+}
+
+int search_set_hash(Search *search, int mb) {
+    search->hash_mb = MAX(mb, 1);
+    table_free(&search->table);
+    return table_alloc(&search->table, search->hash_mb);
+}
+
+int search_hashfull(Search *search) {
+    return search->table.bucket != NULL ? table_hashfull(&search->table) : 0;
+}
+
+int thread_caches_alloc(Thread_d *thread) {
+    if (!pawn_table_alloc(&thread->pawn_table, PAWN_TABLE_BITS))
+        return 0;
+
+    if (!eval_table_alloc(&thread->eval_table, EVAL_TABLE_BITS)) {
+        pawn_table_free(&thread->pawn_table);
+        return 0;
+    }
+
+    // Pin the evaluator before sizing the stack for it
+    eval_search_begin();
+    if (nnue_enabled() && (thread->nnue = nnue_stack_new()) == NULL) {
+        eval_search_end();
+        pawn_table_free(&thread->pawn_table);
+        eval_table_free(&thread->eval_table);
+        return 0;
+    }
+
+    // Static evaluations stored by an earlier evaluator are stale, the main
+    // thread registers first so the evaluator can't change after this
+    if (thread->id == 0 && thread->board.table)
+        table_sync_eval(thread->board.table, eval_version());
+
+    // The weights may have changed since the board was set up
+    board_refresh_eval(&thread->board);
+    thread->board.pawn_table = &thread->pawn_table;
+    thread->board.nnue = thread->nnue;
+    return 1;
+}
+
+void thread_caches_free(Thread_d *thread) {
+    pawn_table_free(&thread->pawn_table);
+    eval_table_free(&thread->eval_table);
+    nnue_stack_free(thread->nnue);
+    eval_search_end();
+    thread->nnue = NULL;
+    thread->board.pawn_table = NULL;
+    thread->board.nnue = NULL;
+}
+
+void search_eval_stats(Search *search, Thread_d *threads, int count) {
+    search->eval_probes = search->eval_hits = search->tt_eval_hits = 0;
+    for (int i = 0; i < count; i++) {
+        search->eval_probes += threads[i].eval_probes;
+        search->eval_hits += threads[i].eval_hits;
+        search->tt_eval_hits += threads[i].tt_eval_hits;
+    }
+}
+
+int best_move(Search *search, ChessBoard *board, Move *result, bool debug) {
+    int best_score = -INF;
+
+    Thread_d *thread = (Thread_d *)calloc(1, sizeof(Thread_d));
+    if (thread == NULL) {
+        err("best_move(): Could not allocate memory for thread");
+        return -best_score;
+    }
+
+    if (!search_init(search)) {
+        free(thread);
+        return -best_score;
+    }
+
+    time_init(&search->tm, &search->tc, &search->limits, board->color);
+    thread->search = search;
+    thread->debug = debug;
+    memcpy(&thread->board, board, sizeof(ChessBoard));
+    thread->board.table = &search->table;
+
+    if (!thread_caches_alloc(thread)) {
+        free(thread);
+        return -best_score;
+    }
+
+    best_score = iterative_deepening(thread);
+
+    *result = thread->move;
+    search->nodes = thread->nodes;
+    search_eval_stats(search, thread, 1);
+
+    thread_caches_free(thread);
+    free(thread);
     return best_score;
 }
\ No newline at end of file
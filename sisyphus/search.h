@@ -6,7 +6,9 @@
 #include "eval.h"
 #include "gen.h"
 #include "move.h"
+#include "picker.h"
 #include "table.h"
+#include "timeman.h"
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,12 +19,42 @@
 #define MATE 100000
 
 #define MAX_DEPTH 100
+#define DEFAULT_HASH_MB 16
 #define VALID_WINDOW 50
 
 #define MAX_R 4
 #define MIN_R 3
 #define DR 4
 
+// Prepare a search, the transposition table is allocated on first use and
+// kept for the lifetime of the Search object
+int search_init(Search *search);
+
+// Clear the transposition table and the eval statistics (new game)
+void search_clear(Search *search);
+
+// Release the transposition table
+void search_free(Search *search);
+
+// Resize the transposition table, its content is lost
+int search_set_hash(Search *search, int mb);
+
+// Permille of the transposition table filled by the last search
+int search_hashfull(Search *search);
+
+// Allocate the evaluation caches private to a search thread, and the
+// accumulator stack when the network is in use, and point its board at them.
+// The evaluator stays pinned until thread_caches_free().
+int thread_caches_alloc(Thread_d *thread);
+
+// Release the evaluation caches of a search thread and unpin the evaluator
+void thread_caches_free(Thread_d *thread);
+
+// Sum the eval cache counters of the search threads into search
+void search_eval_stats(Search *search, Thread_d *threads, int count);
+
+int iterative_deepening(Thread_d *thread);
+
 int best_move(Search *search, ChessBoard *board, Move *result, bool debug);
 
 int staticExchangeEvaluation(ChessBoard *board, Move move, int threshold);
@@ -1,76 +1,276 @@
+#define _DEFAULT_SOURCE
+
 #include "table.h"
+#include <sys/mman.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(Bucket) == 64, "Bucket must fill exactly one cache line");
+
+// Evaluations are stored in 16 bits, biased so a cleared entry reads as empty
+#define EVAL_LIMIT 32000
+#define EVAL_BIAS 32768
+#define EVAL_KEY(key) ((key) & ~U64(0xffff))
+
+// The bucket index comes from the high bits of the key, the check from the low ones
+#define KEY16(key) ((uint16_t)(key))
+#define ENTRY_FLAG(entry) ((entry)->flag_age & 0x3)
+#define ENTRY_AGE(entry) ((entry)->flag_age >> 2)
+#define GENERATION_NB 64
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define PARALLEL_CLEAR_MIN (256 * 1024 * 1024) // Smaller tables are cleared by the caller
+#define HASHFULL_SAMPLE (1000 / BUCKET_SIZE)   // Buckets sampled for hashfull
+
+typedef struct {
+    Bucket *bucket;     // First bucket of the slice
+    size_t size;        // Number of buckets in the slice
+} ClearSlice;
+
+// The piece is implied by the source square, so a move fits in 16 bits
+#define PACK_MOVE(move) ((uint16_t)(((move) & 0xfff) | (EXTRACT_FLAGS(move) << 12)))
+
+INLINE uint16_t pack_eval(int eval) {
+    if (eval > EVAL_LIMIT)
+        eval = EVAL_LIMIT;
+    if (eval < -EVAL_LIMIT)
+        eval = -EVAL_LIMIT;
+    return (uint16_t)(eval + EVAL_BIAS);
+}
+
+INLINE Bucket *table_bucket(Table *table, bb key) {
+    // Map the key onto [0, size) without requiring a power of two size
+    return &table->bucket[(size_t)(((unsigned __int128)key * table->size) >> 64)];
+}
 
 Entry *table_entry(Table *table, bb key) {
-    return &table->entry[key & table->mask];
-};
+    Bucket *bucket = table_bucket(table, key);
+    const uint16_t key16 = KEY16(key);
+
+    for (int i = 0; i < BUCKET_SIZE; i++) {
+        if (bucket->entry[i].key == key16)
+            return &bucket->entry[i];
+    }
+
+    return NULL;
+}
 
 void table_free(Table *table) {
-    free(table->entry);
+    free(table->bucket);
+    memset(table, 0, sizeof(Table));
 };
 
+void table_clear_slice(void *arg) {
+    ClearSlice *slice = (ClearSlice *)arg;
+    memset(slice->bucket, 0, sizeof(Bucket) * slice->size);
+}
+
 void table_prefetch(Table *table, bb key) {
-    __builtin_prefetch(table_entry(table, key));
+    __builtin_prefetch(table_bucket(table, key));
 };
 
 void table_clear(Table *table) {
-    memset(table, 0, sizeof(Table));
+    table->generation = 0;
+    if (table->bucket == NULL)
+        return;
+
+    size_t bytes = sizeof(Bucket) * table->size;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus < 1 ? 1 : cpus > 64 ? 64 : (int)cpus;
+    threadpool thpool_p = NULL;
+
+    if (bytes >= PARALLEL_CLEAR_MIN && threads > 1)
+        thpool_p = thpool_init(threads);
+
+    if (thpool_p == NULL) {
+        memset(table->bucket, 0, bytes);
+        return;
+    }
+
+    ClearSlice slices[64];
+    size_t chunk = table->size / threads;
+
+    for (int i = 0; i < threads; i++) {
+        slices[i].bucket = table->bucket + chunk * i;
+        slices[i].size = i == threads - 1 ? table->size - chunk * i : chunk;
+        if (thpool_add_work(thpool_p, table_clear_slice, &slices[i]) == -1)
+            table_clear_slice(&slices[i]);
+    }
+
+    thpool_wait(thpool_p);
+    thpool_destroy(thpool_p);
 }
 
-int table_alloc(Table *table, int bits) {
-    table_clear(table);
-    table->size = 1 << bits;
-    table->mask = table->size - 1;
-    table->entry = calloc(table->size, sizeof(Entry));
-    if (table->entry == NULL) {
+void table_new_search(Table *table) {
+    table->generation = (table->generation + 1) % GENERATION_NB;
+}
+
+int table_alloc(Table *table, size_t mb) {
+    memset(table, 0, sizeof(Table));
+    table->size = (mb ? mb : 1) * 1024 * 1024 / sizeof(Bucket);
+
+    // Back the table with 2 MB pages when the kernel lets us, it cuts the
+    // TLB misses of random probes into a multi-gigabyte table
+    size_t bytes = sizeof(Bucket) * table->size;
+    size_t huge = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+    table->bucket = aligned_alloc(HUGE_PAGE_SIZE, huge);
+    if (table->bucket != NULL) {
+#ifdef MADV_HUGEPAGE
+        madvise(table->bucket, huge, MADV_HUGEPAGE);
+#endif
+    } else {
+        table->bucket = aligned_alloc(sizeof(Bucket), bytes);
+    }
+
+    if (table->bucket == NULL) {
         err("table_alloc(): failed to allocate transposition table entries");
+        table->size = 0;
         return 0;
     }
+    table_clear(table);
     return 1;
 }
 
-Move table_get_move(Table *table, bb key) {
-    Entry *entry = table_entry(table, key);
-    if (entry->key == key) {
-        return entry->move;
+int table_hashfull(Table *table) {
+    size_t buckets = MIN((size_t)HASHFULL_SAMPLE, table->size);
+    int used = 0;
+
+    for (size_t i = 0; i < buckets; i++) {
+        for (int j = 0; j < BUCKET_SIZE; j++) {
+            Entry *entry = &table->bucket[i].entry[j];
+            used += (ENTRY_FLAG(entry) || entry->move) &&
+                    ENTRY_AGE(entry) == table->generation;
+        }
     }
 
-    return 0;
+    return buckets ? used * 1000 / (int)(buckets * BUCKET_SIZE) : 0;
+}
+
+Move table_unpack_move(ChessBoard *board, uint16_t packed) {
+    int src = packed & 0x3f, dst = (packed >> 6) & 0x3f;
+    int piece = board->squares[src];
+
+    // A 16-bit key collision can hand us a move from another position
+    if (packed == NULL_MOVE || piece == NONE || COLOR(piece) != board->color)
+        return NULL_MOVE;
+
+    return ENCODE_MOVE(src, dst, piece, packed >> 12);
+}
+
+Move table_get_move(Table *table, ChessBoard *board) {
+    Entry *entry = table_entry(table, board->hash);
+    if (entry != NULL) {
+        return table_unpack_move(board, entry->move);
+    }
+
+    return NULL_MOVE;
+}
+
+// Deep entries are worth keeping, entries from earlier searches lose value
+// the older they get.
+INLINE int table_worth(Table *table, Entry *entry) {
+    int age = (table->generation - ENTRY_AGE(entry) + GENERATION_NB) %
+              GENERATION_NB;
+    return entry->depth - 8 * age;
+}
+
+INLINE Entry *table_replace(Table *table, bb key) {
+    Bucket *bucket = table_bucket(table, key);
+    const uint16_t key16 = KEY16(key);
+    Entry *replace = &bucket->entry[0];
+
+    for (int i = 0; i < BUCKET_SIZE; i++) {
+        Entry *entry = &bucket->entry[i];
+        if (entry->key == key16)
+            return entry;
+        if (table_worth(table, entry) < table_worth(table, replace))
+            replace = entry;
+    }
+
+    return replace;
 }
 
 void table_set_move(Table *table, bb key, int depth, Move move) {
-    Entry *entry = table_entry(table, key);
-    if (entry->depth <= depth) {
-        entry->key = key;
+    Entry *entry = table_replace(table, key);
+    if (entry->key != KEY16(key)) {
+        entry->key = KEY16(key);
+        entry->score = 0;
         entry->depth = depth;
-        entry->move = move;
+        entry->flag_age = table->generation << 2;
+        entry->eval = 0;
+    }
+    entry->move = PACK_MOVE(move);
+}
+
+void table_set_eval(Table *table, bb key, int eval) {
+    Entry *entry = table_replace(table, key);
+    if (entry->key != KEY16(key)) {
+        entry->key = KEY16(key);
+        entry->move = NULL_MOVE;
+        entry->score = 0;
+        entry->depth = 0;
+        entry->flag_age = table->generation << 2;
     }
+    entry->eval = pack_eval(eval);
 }
 
-void table_set(Table *table, bb key, int depth, int value, int flag) {
+bool table_get_eval(Table *table, bb key, int *eval) {
     Entry *entry = table_entry(table, key);
-    if (entry->depth <= depth) {
-        entry->key = key;
-        entry->depth = depth;
-        entry->score = value;
-        entry->flag = flag;
+    if (entry == NULL || entry->eval == 0)
+        return false;
+
+    *eval = (int)entry->eval - EVAL_BIAS;
+    return true;
+}
+
+void table_sync_eval(Table *table, int version) {
+    if (table->eval_version == version)
+        return;
+
+    for (size_t i = 0; i < table->size; i++) {
+        for (int j = 0; j < BUCKET_SIZE; j++)
+            table->bucket[i].entry[j].eval = 0;
     }
+    table->eval_version = version;
+}
+
+void table_set(Table *table, bb key, int depth, int value, int flag,
+               Move move) {
+    Entry *entry = table_replace(table, key);
+    const int same = entry->key == KEY16(key);
+
+    // Keep the move of a previous search of this position if we have none
+    if (move != NULL_MOVE || !same)
+        entry->move = PACK_MOVE(move);
+    if (!same)
+        entry->eval = 0;
+
+    // A shallower result of the current search only overwrites exact scores
+    if (same && flag != EXACT && ENTRY_FLAG(entry) &&
+            ENTRY_AGE(entry) == table->generation && entry->depth > depth)
+        return;
+
+    entry->key = KEY16(key);
+    entry->score = value;
+    entry->depth = depth;
+    entry->flag_age = (table->generation << 2) | flag;
 }
 
 int table_get(Table *table, bb key, int depth, int alpha, int beta,
               int *value) {
     Entry *entry = table_entry(table, key);
     int flag = 0;
-    if (entry->key == key) {
+    if (entry != NULL) {
         if (entry->depth >= depth) {
-            if (entry->flag == EXACT) {
+            if (ENTRY_FLAG(entry) == EXACT) {
                 *value = entry->score;
                 flag = 1;
             }
-            if ((entry->flag == ALPHA) && (entry->score <= alpha)) {
+            if ((ENTRY_FLAG(entry) == ALPHA) && (entry->score <= alpha)) {
                 *value = alpha;
                 flag = 1;
             }
-            if ((entry->flag == BETA) && (entry->score >= beta)) {
+            if ((ENTRY_FLAG(entry) == BETA) && (entry->score >= beta)) {
                 *value = beta;
                 flag = 1;
             }
@@ -96,19 +296,57 @@ INLINE PawnEntry *pawn_table_entry(PawnTable *table, bb key) {
     return &table->entry[key & table->mask];
 }
 
-void pawn_table_set(PawnTable *table, bb key, int value) {
+void pawn_table_set(PawnTable *table, bb key, int mg, int eg) {
     PawnEntry *entry = pawn_table_entry(table, key);
     entry->key = key;
-    entry->value = value;
+    entry->mg = mg;
+    entry->eg = eg;
 }
 
-int pawn_table_get(PawnTable *tabke, bb key) {
-    PawnEntry *entry = pawn_table_entry(tabke, key);
-    if (entry->key == key)
-        return entry->value;
-    return 0;
+// A zeroed entry matches the empty pawn structure, whose score is 0 anyway
+bool pawn_table_get(PawnTable *table, bb key, int *mg, int *eg) {
+    PawnEntry *entry = pawn_table_entry(table, key);
+    if (entry->key != key)
+        return false;
+
+    *mg = entry->mg;
+    *eg = entry->eg;
+    return true;
 }
 
 void pawn_table_free(PawnTable *table) {
-    return free(table->entry);
-}
\ No newline at end of file
+    free(table->entry);
+    table->entry = NULL;
+}
+
+int eval_table_alloc(EvalTable *table, int bits) {
+    table->size = 1 << bits;
+    table->mask = table->size - 1;
+    table->entry = calloc(table->size, sizeof(bb));
+
+    if (table->entry == NULL) {
+        err("eval_table_alloc(): failed to allocate evaluation cache entries");
+        return 0;
+    }
+    return 1;
+}
+
+// Key and evaluation share one word, a torn entry can't pair an evaluation
+// with the wrong position
+void eval_table_set(EvalTable *table, bb key, int eval) {
+    table->entry[key & table->mask] = EVAL_KEY(key) | pack_eval(eval);
+}
+
+bool eval_table_get(EvalTable *table, bb key, int *eval) {
+    bb data = table->entry[key & table->mask];
+    if (EVAL_KEY(data) != EVAL_KEY(key) || !(data & 0xffff))
+        return false;
+
+    *eval = (int)(data & 0xffff) - EVAL_BIAS;
+    return true;
+}
+
+void eval_table_free(EvalTable *table) {
+    free(table->entry);
+    table->entry = NULL;
+}
@@ -18,25 +18,71 @@
 // Prefetch table entry for given position key
 void table_prefetch(Table *table, bb key);
 
-// Allocate memory for transposition table
-int table_alloc(Table *table, int bits);
+// Allocate a transposition table of the given size in megabytes
+int table_alloc(Table *table, size_t mb);
 
 // Free table memory
 void table_free(Table *table);
 
-// Get table entry for a position
+// Forget every stored position, large tables are cleared in parallel
+void table_clear(Table *table);
+
+// Permille of the table used by the current search generation
+int table_hashfull(Table *table);
+
+// Start a new search generation, older entries become replaceable
+void table_new_search(Table *table);
+
+// Get table entry for a position, NULL if it is not stored
 Entry *table_entry(Table *table, bb key);
 
-// Get stored move from table
-Move table_get_move(Table *table, bb key);
+// Rebuild a full move from its packed form, NULL_MOVE if it does not fit the board
+Move table_unpack_move(ChessBoard *board, uint16_t packed);
+
+// Get stored move for the board position
+Move table_get_move(Table *table, ChessBoard *board);
 
 // Store move in table
 void table_set_move(Table *table, bb key, int depth, Move move);
 
-// Store position evaluation in table
-void table_set(Table *table, bb key, int depth, int value, int flag);
+// Store position evaluation and best move (or NULL_MOVE) in table
+void table_set(Table *table, bb key, int depth, int value, int flag, Move move);
 
 // Retrieve position evaluation from table
 int table_get(Table *table, bb key, int depth, int alpha, int beta, int *value);
 
+// Attach the static evaluation to the entry of a position
+void table_set_eval(Table *table, bb key, int eval);
+
+// Retrieve the static evaluation of a position, false if it is not stored
+bool table_get_eval(Table *table, bb key, int *eval);
+
+// Drop every stored static evaluation unless they come from this evaluator
+// version
+void table_sync_eval(Table *table, int version);
+
+// Allocate a pawn structure cache of 2^bits entries
+int pawn_table_alloc(PawnTable *table, int bits);
+
+// Store the pawn structure score of a pawn hash
+void pawn_table_set(PawnTable *table, bb key, int mg, int eg);
+
+// Retrieve the pawn structure score of a pawn hash, false if it is not stored
+bool pawn_table_get(PawnTable *table, bb key, int *mg, int *eg);
+
+// Free pawn table memory
+void pawn_table_free(PawnTable *table);
+
+// Allocate a static evaluation cache of 2^bits entries
+int eval_table_alloc(EvalTable *table, int bits);
+
+// Store the static evaluation of a position
+void eval_table_set(EvalTable *table, bb key, int eval);
+
+// Retrieve the static evaluation of a position, false if it is not stored
+bool eval_table_get(EvalTable *table, bb key, int *eval);
+
+// Free eval table memory
+void eval_table_free(EvalTable *table);
+
 #endif
\ No newline at end of file
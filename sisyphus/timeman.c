@@ -0,0 +1,96 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "timeman.h"
+#include "move.h"
+#include <time.h>
+
+#define DEFAULT_MOVES_TO_GO 30 // Moves expected until the end of a sudden death game
+#define MAX_MOVES_TO_GO 50
+#define MAX_STABILITY 4
+
+// Percent of the soft limit used, by number of iterations the best move held
+static const int STABILITY_SCALE[MAX_STABILITY + 1] = {200, 130, 100, 85, 75};
+
+int64_t time_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void time_init(TimeManager *tm, const TimeControl *tc, const Limits *limits,
+               int color) {
+    int time = tc->time[color], inc = tc->inc[color];
+
+    tm->start = time_now();
+    tm->last = 0;
+    tm->stability = 0;
+    tm->iterations = 0;
+    tm->best = NULL_MOVE;
+    tm->score = 0;
+    tm->fixed = limits->movetime > 0;
+    tm->enabled = tm->fixed || time > 0;
+
+    if (tm->fixed) {
+        tm->soft = tm->hard = limits->movetime;
+        return;
+    }
+
+    if (!tm->enabled)
+        return;
+
+    int mtg = tc->movestogo > 0 ? tc->movestogo : DEFAULT_MOVES_TO_GO;
+    mtg = mtg < MAX_MOVES_TO_GO ? mtg : MAX_MOVES_TO_GO;
+
+    int left = time - tc->overhead;
+    left = left > 1 ? left : 1;
+
+    // Never plan to use more than three quarters of the clock on one move
+    int soft = left / mtg + inc * 3 / 4;
+    int hard = soft * 4;
+    hard = hard < left * 3 / 4 ? hard : left * 3 / 4;
+
+    tm->hard = hard > 1 ? hard : 1;
+    tm->soft = soft < tm->hard ? soft : tm->hard;
+}
+
+int time_elapsed(const TimeManager *tm) {
+    return (int)(time_now() - tm->start);
+}
+
+bool time_over(const TimeManager *tm) {
+    return tm->enabled && time_elapsed(tm) >= tm->hard;
+}
+
+bool time_stop_iteration(TimeManager *tm, Move best, int score) {
+    if (!tm->enabled || tm->fixed)
+        return false;
+
+    int elapsed = time_elapsed(tm), scale;
+
+    if (tm->iterations > 0 && best == tm->best)
+        tm->stability += tm->stability < MAX_STABILITY;
+    else
+        tm->stability = 0;
+
+    scale = STABILITY_SCALE[tm->stability];
+
+    // Spend up to twice the time when the score falls, a refutation of the
+    // best move may show up one iteration later
+    if (tm->iterations > 0 && score < tm->score) {
+        int drop = tm->score - score;
+        scale += drop < 200 ? drop / 2 : 100;
+    }
+
+    int iteration = elapsed - tm->last;
+    int limit = (int)((int64_t)tm->soft * scale / 100);
+    limit = limit < tm->hard ? limit : tm->hard;
+
+    tm->best = best;
+    tm->score = score;
+    tm->last = elapsed;
+    tm->iterations++;
+
+    // The next iteration takes at least twice as long as this one, don't
+    // start it if the hard limit would cut it short
+    return elapsed >= limit || elapsed + 2 * iteration >= tm->hard;
+}
@@ -0,0 +1,30 @@
+#ifndef TIMEMAN_H
+#define TIMEMAN_H
+
+#include "types.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DEFAULT_MOVE_OVERHEAD 30 // Milliseconds lost per move to the GUI and OS
+#define TIME_CHECK_MASK 1023     // Poll the clock every 1024 nodes
+
+// Milliseconds since an arbitrary monotonic origin
+int64_t time_now(void);
+
+// Compute the soft and hard limits of a search from a fixed movetime or the
+// clock of the side to move, the manager stays disabled when neither is given
+void time_init(TimeManager *tm, const TimeControl *tc, const Limits *limits,
+               int color);
+
+// Milliseconds since time_init
+int time_elapsed(const TimeManager *tm);
+
+// True once the hard limit is reached, the search must stop immediately
+bool time_over(const TimeManager *tm);
+
+// Called after each completed iteration of the main thread, true when the
+// next iteration should not be started. The soft limit is stretched while
+// the best move keeps changing or the score drops, and cut when it is stable.
+bool time_stop_iteration(TimeManager *tm, Move best, int score);
+
+#endif
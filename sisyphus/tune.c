@@ -0,0 +1,394 @@
+// Texel tuning of the PESTO weights over labelled positions.
+//
+// Every line holds a FEN followed by the game result from white's point of
+// view, as "1-0", "0-1", "1/2-1/2" (EPD c9 style), "[1.0]", "[0.5]", "[0.0]"
+// or a bare number. Positions are kept as a compact list of piece features,
+// the pawn structure and piece layers of eval() are folded into a constant
+// per position, so the evaluation is linear in the tuned weights.
+//
+// The loss is the mean squared error between the result and
+// sigmoid(K * eval), K is fitted first and then kept fixed. Gradients are
+// analytic and accumulated over all positions in parallel, Adam updates the
+// weights once per pass. The tuned weights are written as a parameter file
+// for pesto_load().
+//
+// Usage: tune <positions> [output] [epochs] [threads] [parameters]
+
+#include "board.h"
+#include "eval.h"
+#include "timeman.h"
+#include <inttypes.h>
+#include <math.h>
+
+#define TUNE_OUTPUT "pesto.txt"
+#define TUNE_EPOCHS 500
+#define TUNE_REPORT 25      // Epochs between progress lines
+#define TUNE_RATE 1.0       // Adam step size, in centipawns
+#define TUNE_BETA1 0.9
+#define TUNE_BETA2 0.999
+#define TUNE_LINE 1024
+#define TUNE_LN10 2.302585092994046
+
+// Weight vector: material then tables by piece, middlegame half first
+#define TUNE_HALF (6 + 6 * 64)
+#define TUNE_PARAMS (2 * TUNE_HALF)
+
+// A feature is a table index (piece * 64 + square as stored in the table)
+// with the sign of the piece owner in the top bit
+#define FEATURE_BLACK 0x8000
+#define FEATURE_INDEX(f) ((f) & 0x1ff)
+
+typedef struct {
+    uint32_t first;     // First feature in TuneData.features
+    uint8_t count;      // Number of features (pieces)
+    uint8_t phase;      // Game phase, 24 is the opening
+    uint8_t result;     // 0 loss, 1 draw, 2 white win
+    int16_t fixed_mg;   // Untuned layers of eval(), white relative
+    int16_t fixed_eg;
+} TunePosition;
+
+typedef struct {
+    TunePosition *positions;
+    uint16_t *features;
+    size_t count;
+    size_t feature_count;
+    size_t capacity;
+    size_t feature_capacity;
+} TuneData;
+
+typedef struct {
+    const TuneData *data;
+    const double *params;
+    double k;
+    size_t begin, end;
+    bool gradient;              // Accumulate grad as well as the loss
+    double loss;
+    double grad[TUNE_PARAMS];
+} TuneJob;
+
+static bool parse_result(const char *text, uint8_t *result) {
+    const char *bracket;
+    char *end;
+
+    if (strstr(text, "1/2-1/2") != NULL) {
+        *result = 1;
+        return true;
+    }
+    if (strstr(text, "1-0") != NULL) {
+        *result = 2;
+        return true;
+    }
+    if (strstr(text, "0-1") != NULL) {
+        *result = 0;
+        return true;
+    }
+
+    // "[score]", otherwise the last field, as the move clocks may come first
+    if ((bracket = strchr(text, '[')) != NULL) {
+        text = bracket + 1;
+    } else {
+        const char *last = text + strlen(text);
+        while (last > text && strchr(" \t\r\n;\"", last[-1]) != NULL)
+            last--;
+        while (last > text && strchr(" \t|,\"", last[-1]) == NULL)
+            last--;
+        text = last;
+    }
+
+    double score = strtod(text, &end);
+    if (end == text || score < 0.0 || score > 1.0)
+        return false;
+    *result = (uint8_t)lround(score * 2);
+    return true;
+}
+
+static bool tune_data_add(TuneData *data, ChessBoard *board, uint8_t result) {
+    if (data->count == data->capacity) {
+        size_t capacity = data->capacity ? data->capacity * 2 : 1 << 16;
+        TunePosition *positions = realloc(data->positions, capacity * sizeof(TunePosition));
+        if (positions == NULL)
+            return false;
+        data->positions = positions;
+        data->capacity = capacity;
+    }
+
+    if (data->feature_count + 32 > data->feature_capacity) {
+        size_t capacity = data->feature_capacity ? data->feature_capacity * 2 : 1 << 20;
+        uint16_t *features = realloc(data->features, capacity * sizeof(uint16_t));
+        if (features == NULL)
+            return false;
+        data->features = features;
+        data->feature_capacity = capacity;
+    }
+
+    TunePosition *pos = &data->positions[data->count++];
+    int mg, eg, sq;
+
+    pos->first = (uint32_t)data->feature_count;
+    pos->count = 0;
+    pos->phase = board->gamePhase > 24 ? 24 : board->gamePhase;
+    pos->result = result;
+
+    evaluate_pawns(board, &mg, &eg);
+    pos->fixed_mg = mg;
+    pos->fixed_eg = eg;
+    evaluate_pieces(board, &mg, &eg);
+    pos->fixed_mg += mg;
+    pos->fixed_eg += eg;
+
+    for (int piece = WHITE_PAWN; piece <= BLACK_KING; piece++) {
+        bb pieces = board->bb_squares[piece];
+        while (pieces && pos->count < 32) {
+            POP_LSB(sq, pieces);
+            // White reads the tables flipped, as init_table() does
+            int index = PIECE(piece) * 64 + (COLOR(piece) == WHITE ? FLIP(sq) : sq);
+            data->features[data->feature_count++] =
+                index | (COLOR(piece) == BLACK ? FEATURE_BLACK : 0);
+            pos->count++;
+        }
+    }
+    return true;
+}
+
+static int tune_data_load(TuneData *data, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        err("tune_data_load(): could not open the position file");
+        return 0;
+    }
+
+    static ChessBoard board;
+    char line[TUNE_LINE];
+    size_t skipped = 0;
+
+    board_init(&board);
+    while (fgets(line, sizeof(line), file) != NULL) {
+        // The FEN is the first four fields, the result follows somewhere after
+        char *rest = line;
+        for (int field = 0; field < 4 && rest != NULL; field++) {
+            rest = strchr(rest, ' ');
+            if (rest != NULL)
+                rest++;
+        }
+
+        uint8_t result;
+        if (rest == NULL || !parse_result(rest, &result)) {
+            skipped++;
+            continue;
+        }
+
+        board_load_fen(&board, line);
+        if (!board.bb_squares[WHITE_KING] || !board.bb_squares[BLACK_KING]) {
+            skipped++;
+            continue;
+        }
+
+        if (!tune_data_add(data, &board, result)) {
+            err("tune_data_load(): out of memory");
+            fclose(file);
+            return 0;
+        }
+    }
+    fclose(file);
+
+    if (skipped)
+        printf("Skipped %zu unreadable lines\n", skipped);
+    return data->count > 0;
+}
+
+static void tune_data_free(TuneData *data) {
+    free(data->positions);
+    free(data->features);
+}
+
+static void params_from_tables(double *params) {
+    for (int p = PAWN; p <= KING; p++) {
+        params[p] = mg_value[p];
+        params[TUNE_HALF + p] = eg_value[p];
+        for (int sq = 0; sq < 64; sq++) {
+            params[6 + p * 64 + sq] = mg_pesto_table[p][sq];
+            params[TUNE_HALF + 6 + p * 64 + sq] = eg_pesto_table[p][sq];
+        }
+    }
+}
+
+static void params_to_tables(const double *params) {
+    for (int p = PAWN; p <= KING; p++) {
+        mg_value[p] = (int)lround(params[p]);
+        eg_value[p] = (int)lround(params[TUNE_HALF + p]);
+        for (int sq = 0; sq < 64; sq++) {
+            mg_pesto_table[p][sq] = (int)lround(params[6 + p * 64 + sq]);
+            eg_pesto_table[p][sq] = (int)lround(params[TUNE_HALF + 6 + p * 64 + sq]);
+        }
+    }
+}
+
+INLINE double sigmoid(double k, double eval) {
+    return 1.0 / (1.0 + exp(-k * eval * TUNE_LN10 / 400.0));
+}
+
+// Loss, and optionally its gradient, over a slice of the positions
+static void tune_job(void *arg) {
+    TuneJob *job = (TuneJob *)arg;
+    const TuneData *data = job->data;
+    const double *params = job->params;
+
+    job->loss = 0.0;
+    if (job->gradient)
+        memset(job->grad, 0, sizeof(job->grad));
+
+    for (size_t i = job->begin; i < job->end; i++) {
+        const TunePosition *pos = &data->positions[i];
+        const uint16_t *features = &data->features[pos->first];
+        double mg = pos->fixed_mg, eg = pos->fixed_eg;
+
+        for (int j = 0; j < pos->count; j++) {
+            int index = FEATURE_INDEX(features[j]);
+            double sign = features[j] & FEATURE_BLACK ? -1.0 : 1.0;
+            mg += sign * (params[index / 64] + params[6 + index]);
+            eg += sign * (params[TUNE_HALF + index / 64] + params[TUNE_HALF + 6 + index]);
+        }
+
+        double mgWeight = pos->phase / 24.0, egWeight = 1.0 - mgWeight;
+        double s = sigmoid(job->k, mg * mgWeight + eg * egWeight);
+        double error = pos->result / 2.0 - s;
+        job->loss += error * error;
+
+        if (!job->gradient)
+            continue;
+
+        // d(error^2)/d(eval), the mean is taken by the caller
+        double delta = -2.0 * error * s * (1.0 - s) * job->k * TUNE_LN10 / 400.0;
+        for (int j = 0; j < pos->count; j++) {
+            int index = FEATURE_INDEX(features[j]);
+            double d = features[j] & FEATURE_BLACK ? -delta : delta;
+            job->grad[index / 64] += d * mgWeight;
+            job->grad[6 + index] += d * mgWeight;
+            job->grad[TUNE_HALF + index / 64] += d * egWeight;
+            job->grad[TUNE_HALF + 6 + index] += d * egWeight;
+        }
+    }
+}
+
+// Mean loss over all positions, the mean gradient in grad when not NULL
+static double tune_loss(threadpool pool, TuneJob *jobs, int threads, const TuneData *data,
+                        const double *params, double k, double *grad) {
+    size_t chunk = (data->count + threads - 1) / threads;
+    double loss = 0.0;
+
+    for (int i = 0; i < threads; i++) {
+        jobs[i].data = data;
+        jobs[i].params = params;
+        jobs[i].k = k;
+        jobs[i].begin = MIN(chunk * i, data->count);
+        jobs[i].end = MIN(chunk * (i + 1), data->count);
+        jobs[i].gradient = grad != NULL;
+        if (thpool_add_work(pool, tune_job, &jobs[i]) == -1)
+            tune_job(&jobs[i]);
+    }
+    thpool_wait(pool);
+
+    if (grad != NULL)
+        memset(grad, 0, TUNE_PARAMS * sizeof(double));
+    for (int i = 0; i < threads; i++) {
+        loss += jobs[i].loss;
+        for (int j = 0; grad != NULL && j < TUNE_PARAMS; j++)
+            grad[j] += jobs[i].grad[j];
+    }
+
+    for (int j = 0; grad != NULL && j < TUNE_PARAMS; j++)
+        grad[j] /= data->count;
+    return loss / data->count;
+}
+
+// Golden section search of the K minimising the loss of the current weights
+static double tune_fit_k(threadpool pool, TuneJob *jobs, int threads, const TuneData *data,
+                         const double *params) {
+    const double ratio = (sqrt(5.0) - 1.0) / 2.0;
+    double lo = 0.0, hi = 4.0;
+    double a = hi - ratio * (hi - lo), b = lo + ratio * (hi - lo);
+    double la = tune_loss(pool, jobs, threads, data, params, a, NULL);
+    double lb = tune_loss(pool, jobs, threads, data, params, b, NULL);
+
+    for (int i = 0; i < 40; i++) {
+        if (la < lb) {
+            hi = b;
+            b = a;
+            lb = la;
+            a = hi - ratio * (hi - lo);
+            la = tune_loss(pool, jobs, threads, data, params, a, NULL);
+        } else {
+            lo = a;
+            a = b;
+            la = lb;
+            b = lo + ratio * (hi - lo);
+            lb = tune_loss(pool, jobs, threads, data, params, b, NULL);
+        }
+    }
+    return (lo + hi) / 2.0;
+}
+
+int main(int argc, char **argv) {
+    const char *output = argc > 2 ? argv[2] : TUNE_OUTPUT;
+    int epochs = argc > 3 ? atoi(argv[3]) : TUNE_EPOCHS;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = argc > 4 ? atoi(argv[4]) : (cpus < 1 ? 1 : (int)cpus);
+    static TuneData data;
+    static double params[TUNE_PARAMS], grad[TUNE_PARAMS];
+    static double m[TUNE_PARAMS], v[TUNE_PARAMS];
+
+    if (argc < 2 || epochs < 0 || threads < 1) {
+        fprintf(stderr, "usage: %s <positions> [output] [epochs] [threads] [parameters]\n",
+                argv[0]);
+        return 1;
+    }
+
+    bb_init();
+    init_table();
+    if (argc > 5 && !pesto_load(argv[5]))
+        return 1;
+
+    int64_t start = time_now();
+    if (!tune_data_load(&data, argv[1]))
+        return 1;
+    printf("Loaded %zu positions (%zu KB) in %" PRId64 " ms\n", data.count,
+           (data.count * sizeof(TunePosition) + data.feature_count * sizeof(uint16_t)) / 1024,
+           time_now() - start);
+
+    TuneJob *jobs = calloc(threads, sizeof(TuneJob));
+    threadpool pool = thpool_init(threads);
+    if (jobs == NULL || pool == NULL) {
+        err("tune: could not start the worker threads");
+        return 1;
+    }
+
+    params_from_tables(params);
+    double k = tune_fit_k(pool, jobs, threads, &data, params);
+    printf("K %.4f, loss %.6f\n", k, tune_loss(pool, jobs, threads, &data, params, k, NULL));
+
+    start = time_now();
+    for (int epoch = 1; epoch <= epochs; epoch++) {
+        double loss = tune_loss(pool, jobs, threads, &data, params, k, grad);
+
+        for (int j = 0; j < TUNE_PARAMS; j++) {
+            m[j] = TUNE_BETA1 * m[j] + (1.0 - TUNE_BETA1) * grad[j];
+            v[j] = TUNE_BETA2 * v[j] + (1.0 - TUNE_BETA2) * grad[j] * grad[j];
+            double mHat = m[j] / (1.0 - pow(TUNE_BETA1, epoch));
+            double vHat = v[j] / (1.0 - pow(TUNE_BETA2, epoch));
+            params[j] -= TUNE_RATE * mHat / (sqrt(vHat) + 1e-12);
+        }
+
+        if (epoch % TUNE_REPORT == 0 || epoch == epochs)
+            printf("Epoch %5d  loss %.6f  %" PRId64 " ms\n", epoch, loss, time_now() - start);
+    }
+
+    params_to_tables(params);
+    int ok = pesto_save(output);
+    if (ok)
+        printf("Wrote %s\n", output);
+
+    thpool_destroy(pool);
+    free(jobs);
+    tune_data_free(&data);
+    return !ok;
+}
@@ -2,6 +2,7 @@
 #define TYPES_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #define INLINE inline __attribute__((always_inline))
@@ -24,9 +25,68 @@
 
 typedef unsigned long long bb; // Bitboard type definition (64-bit unsigned integer)
 
+#define MAX_PLY 100 // Maximum search ply
+#define MAX_MOVES 218 // Maximum possible moves in any position
+#define MAX_MULTIPV 16 // Maximum number of PV lines searched
+
+#define SQUARE_NB 64
+#define COLOR_NB 2
+#define FILE_NB 8
+#define RANK_NB 8
+
 #define U64(u) u##ULL
 #define U32(u) u##U
 
+#define BUCKET_SIZE 5 // Transposition table entries per cache line
+#define PAWN_TABLE_BITS 14 // Pawn structure cache entries per thread (log2)
+#define EVAL_TABLE_BITS 16 // Static evaluation cache entries per thread (log2)
+
+// Hash the kings into pawn_hash, needed once pawn terms depend on them
+#ifndef PAWN_HASH_KINGS
+#define PAWN_HASH_KINGS 0
+#endif
+
+typedef struct {
+    uint16_t key;       // Upper 16 bits of the position hash
+    uint16_t move;      // Packed best move (from | to << 6 | flags << 12)
+    int32_t score;      // Evaluation score
+    uint8_t depth;      // Search depth
+    uint8_t flag_age;   // Entry type flag (2 bits) | search generation (6 bits)
+    uint16_t eval;      // Static evaluation biased to be non zero, 0 if not stored
+} Entry;
+
+typedef struct {
+    Entry entry[BUCKET_SIZE]; // Entries sharing one cache line
+    uint32_t padding;         // Pad the bucket to 64 bytes
+} Bucket;
+
+typedef struct {
+    size_t size;        // Number of buckets
+    Bucket *bucket;     // Array of 64-byte buckets
+    int generation;     // Current search generation
+    int eval_version;   // eval_version() the stored static evaluations come from
+} Table;
+
+typedef struct {
+    bb key;             // Pawn structure hash
+    int mg;             // Middlegame pawn structure score for white
+    int eg;             // Endgame pawn structure score for white
+} PawnEntry;
+
+typedef struct {
+    int size;           // Table size
+    int mask;           // Size mask for indexing
+    PawnEntry *entry;   // Array of entries
+} PawnTable;
+
+typedef struct {
+    int size;           // Table size
+    int mask;           // Mask for indexing
+    bb *entry;          // Upper 48 bits of the position hash | 16 bit evaluation
+} EvalTable;
+
+typedef struct NNUEStack NNUEStack; // Accumulator stack, private to nnue.c
+
 typedef struct {
     int squares[64]; // Piece placement array
     int numMoves;    // Number of moves played 
@@ -43,11 +103,22 @@ typedef struct {
 
     bb ep;           // En passant square bitboard
     bb hash;         // Position hash
-    bb pawn_hash;    // Pawn structure hash (not used)
+    bb pawn_hash;    // Pawn structure hash, with the kings if PAWN_HASH_KINGS
+    bb checkers;     // Pieces giving check to the side to move
+
+    Table *table;    // Transposition table prefetched by do_move (optional)
+    PawnTable *pawn_table; // Pawn structure cache of the owning thread (optional)
+    NNUEStack *nnue;       // Accumulators of the owning thread, NULL to refresh on every eval
 } ChessBoard;
 
 typedef uint32_t Move; // Move type (32-bit unsigned integer)
 
+typedef struct {
+    bb squares[6];   // Squares from which each piece type checks the enemy king
+    bb blockers;     // Own pieces whose move may discover a check
+    int king;        // Enemy king square
+} CheckInfo;
+
 typedef int (*MoveGen)(ChessBoard *, Move *);
 typedef int (*AttacksGen)(ChessBoard *, Move *, bb);
 
@@ -55,58 +126,128 @@ typedef struct {
     int capture; // Captured piece 
     int castle; // Previous castling rights
     bb ep;      // Previous en passant square
+    bb checkers; // Previous checkers bitboard
 } Undo;
 
 typedef struct {
-    bb key;             // Position hash
-    int score;          // Evaluation score
-    int depth;          // Search depth
-    int flag;           // Entry type flag
-    Move move;          // Best move
-} Entry;
+    int time[COLOR_NB]; // Remaining clock in ms, 0 when the search is not timed
+    int inc[COLOR_NB];  // Increment per move in ms
+    int movestogo;      // Moves to the next time control, 0 for sudden death
+    int overhead;       // Move overhead in ms
+} TimeControl;
 
 typedef struct {
-    int size;           // Table size
-    int mask;           // Size mask for indexing
-    Entry *entry;       // Array of entries
-} Table;
+    int depth;          // Maximum depth
+    uint64_t nodes;     // Maximum nodes of the main thread
+    int mate;           // Stop once a mate in this many moves is found
+    int movetime;       // Fixed search time in ms
+} Limits;               // Zero fields are not limited
 
 typedef struct {
-    bb key;             // Pawn structure hash
-    int value;          // Evaluation score
-} PawnEntry;
+    int64_t start;      // Search start in ms
+    int soft;           // Don't start a new iteration past this (ms)
+    int hard;           // Abort the search past this (ms)
+    int last;           // Elapsed ms at the end of the previous iteration
+    int stability;      // Iterations the best move stayed the same
+    int iterations;     // Completed iterations
+    Move best;          // Best move of the previous iteration
+    int score;          // Score of the previous iteration
+    bool enabled;       // False when the search is not timed
+    bool fixed;         // Fixed movetime, use all of it
+} TimeManager;
 
 typedef struct {
-    int size;           // Table size
-    int mask;           // Size mask for indexing
-    PawnEntry *entry;   // Array of entries
-} PawnTable;
+    int score;          // Score of the line
+    int depth;          // Depth the line was searched to
+    int pv_length;      // Number of moves in pv
+    Move pv[MAX_PLY];   // Moves of the line, pv[0] is the root move
+} PVLine;
 
 typedef struct {
-    int nodes;          // Nodes searched
+    int depth;          // Completed depth, or the depth being searched for currmove
+    int multipv;        // 1 based index of the line reported
+    int seldepth;       // Deepest ply reached by the main thread
+    int score;          // Score of the iteration
+    uint64_t nodes;     // Nodes searched by all threads
+    uint64_t nps;       // Nodes per second
+    int time;           // Elapsed ms
+    int hashfull;       // Permille of the transposition table used
+    Move currmove;      // Root move being searched, NULL_MOVE for iteration reports
+    int currmovenumber; // 1 based index of currmove
+    int pv_length;      // Number of moves in pv
+    Move pv[MAX_PLY];   // Principal variation
+} SearchInfo;
+
+// Receives search progress from the main search thread
+typedef void (*InfoCallback)(const SearchInfo *info, void *data);
+
+typedef struct SearchJob SearchJob; // Running search, private to board.c
+
+typedef struct {
+    uint64_t nodes;     // Nodes searched
     bool stop;          // Search stop flag
+    bool ponder;        // Searching on the opponent's time, no time limit
     Move move;          // Best move found
     Table table;        // Transposition table
+    int depth;          // Depth completed by the main thread
+    int hash_mb;        // Transposition table size in MB (0 for the default)
+    SearchJob *job;     // Search started by search_start, NULL when idle
+    Limits limits;      // Limits given by the caller
+    TimeControl tc;     // Clock given by the caller
+    TimeManager tm;     // Time limits derived from tc and limits at search start
+    InfoCallback info;  // Called after every iteration, NULL for none
+    void *info_data;    // Passed back to info
+    int info_interval;  // Minimum ms between current move reports, 0 for none
+    int info_last;      // Elapsed ms of the last current move report
+    int multipv;        // Number of PV lines searched, 0 or 1 for a single line
+    int searchmoves_count;          // Number of searchmoves, 0 searches all
+    Move searchmoves[MAX_MOVES];    // Root moves the search is restricted to
+    int line_count;                 // Lines completed by the last iteration
+    PVLine lines[MAX_MULTIPV];      // Best lines of the main thread by score
+    uint64_t eval_probes;           // Static evaluations requested by the last search
+    uint64_t eval_hits;             // Of which found in the per thread eval caches
+    uint64_t tt_eval_hits;          // Of which found in the transposition table
 } Search;
 
 typedef struct {
+    int id;             // Thread index (0 is the main thread)
     int score;          // Evaluation score
+    int depth;          // Last completed depth
+    uint64_t nodes;     // Nodes searched by this thread
+    int seldepth;       // Deepest ply reached in the current iteration
     bool debug;         // Debug flag
-    Search *search;     // Search information
-    ChessBoard *board;  // Board state
-    Move *move;         // Move to be played
+    Search *search;     // Shared search information
+    ChessBoard board;   // Private copy of the board state
+    Move move;          // Best move found by this thread
+
+    int history[COLOR_NB][SQUARE_NB][SQUARE_NB]; // History heuristic scores
+    Move killers[COLOR_NB][MAX_PLY];             // Killer moves per ply
+
+    Move pv[MAX_PLY + 1][MAX_PLY];  // Triangular PV table, pv[ply][0] is played at ply
+    int pv_length[MAX_PLY + 1];     // Number of moves in pv[ply]
+    bool follow_pv;                 // Still on the path of the previous PV
+
+    int pv_index;                // Line being searched, earlier ones are excluded
+    int line_count;              // Lines completed by the last iteration
+    PVLine lines[MAX_MULTIPV];   // Lines of the current and last iteration
+
+    PawnTable pawn_table;        // Pawn structure cache, board.pawn_table points at it
+    EvalTable eval_table;        // Static evaluation cache
+    NNUEStack *nnue;             // Accumulator stack when the network is in use
+    uint64_t eval_probes;        // Static evaluations requested
+    uint64_t eval_hits;          // Of which found in eval_table
+    uint64_t tt_eval_hits;       // Of which found in the transposition table
 } Thread_d;
 
 typedef struct {
-    bb key;             // Position hash
-    bb value;           // Stored value
-    int depth;          // Search depth
+    bb key;             // Position hash xor data
+    bb data;            // Node count << 8 | depth
 } Entry_t;
 
-#define SQUARE_NB 64
-#define COLOR_NB 2
-#define FILE_NB 8
-#define RANK_NB 8
+typedef struct {
+    Entry_t *entries;   // Perft hash shared by all workers
+    bb mask;            // Number of entries - 1, a power of two
+} PerftTable;
 
 #define PAWN_MATERIAL 100
 #define KNIGHT_MATERIAL 320
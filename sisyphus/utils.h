@@ -5,9 +5,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-// Generic swap function for any data type
-void swap_any(void *a, void *b, size_t s);
-
 // String duplication function
 char *strdup(const char *src);
 
@@ -1,12 +1,13 @@
 #include "zobrist.h"
 #include "utils.h"
+#include <pthread.h>
 
 bb HASH_PIECES[12][64];
 bb HASH_EP[8];
 bb HASH_CASTLE[16];
 bb HASH_COLOR_SIDE;
 
-void init_zobrist() {
+static void generate_zobrist() {
     for (int i = 0; i < 12; i++) {
         for (int j = 0; j < 64; j++) {
             HASH_PIECES[i][j] = xorshift64();
@@ -23,6 +24,13 @@ void init_zobrist() {
     HASH_COLOR_SIDE = xorshift64();
 }
 
+void init_zobrist() {
+    // Keys are generated once, every board shares them. Boards may be created
+    // from several threads, so no caller may see the tables half filled
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, generate_zobrist);
+}
+
 void gen_curr_state_zobrist(ChessBoard *board) {
     for (int pc = WHITE_PAWN; pc <= BLACK_KING; pc++) {
         bb bbit = board->bb_squares[pc];
@@ -46,8 +54,12 @@ void gen_curr_state_zobrist(ChessBoard *board) {
 }
 
 void gen_pawn_zobrist(ChessBoard *board) {
+    // Placement only, the pawn structure score does not depend on the side to
+    // move or en passant
+    for (int pc = WHITE_PAWN; pc <= BLACK_KING; pc++) {
+        if (!PAWN_HASHED(pc))
+            continue;
 
-    for (int pc = WHITE_PAWN; pc <= BLACK_PAWN; pc++) {
         bb bbit = board->bb_squares[pc];
         int sq;
         while (bbit) {
@@ -55,12 +67,4 @@ void gen_pawn_zobrist(ChessBoard *board) {
             board->pawn_hash ^= HASH_PIECES[pc][sq];
         }
     }
-
-    if (board->ep) {
-        board->pawn_hash ^= HASH_EP[get_lsb(board->ep) % 8];
-    }
-
-    if (board->color) {
-        board->pawn_hash ^= HASH_COLOR_SIDE;
-    }
 }
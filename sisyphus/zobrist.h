@@ -23,6 +23,10 @@ void init_zobrist();
 // Generate Zobrist hash for current board state
 void gen_curr_state_zobrist(ChessBoard *board);
 
+// Pieces hashed into pawn_hash
+#define PAWN_HASHED(piece)                                                     \
+  ((piece) <= BLACK_PAWN || (PAWN_HASH_KINGS && (piece) >= WHITE_KING && (piece) <= BLACK_KING))
+
 // Generate Zobrist hash for pawn structure
 void gen_pawn_zobrist(ChessBoard *board);
 
@@ -1,5 +1,13 @@
+import asyncio
+import ctypes
 import logging
+import os
+import random
+import struct
 import sys
+import tempfile
+import threading
+import time
 import unittest
 import sisyphus
 
@@ -182,6 +190,56 @@ class BoardTestCase(unittest.TestCase):
         with self.assertRaises(ValueError):
             board.perft_test(-1)
 
+    def test_perft_parallel(self):
+        board = sisyphus.Board(
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"
+        )
+        fen = board.fen
+        for threads, hash_mb in ((1, 0), (4, 1), (3, 0), (2, 16)):
+            self.assertEqual(board.perft_test(4, threads, hash_mb), 4085603)
+        self.assertEqual(board.fen, fen)
+
+    def test_perft_divide(self):
+        board = sisyphus.Board(
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"
+        )
+        divide = board.perft_divide(3)
+        self.assertEqual(len(divide), 48)
+        self.assertEqual(sum(divide.values()), 97862)
+        self.assertEqual(divide[sisyphus.Move.parse_uci(board, "e1g1")], 2059)
+        self.assertEqual(divide[sisyphus.Move.parse_uci(board, "d5e6")], 2241)
+        with self.assertRaises(ValueError):
+            board.perft_divide(0)
+
+    def test_legal_moves(self):
+        # The en passant capture would expose the king along the rank
+        board = sisyphus.Board("8/8/8/K2pP2q/8/8/8/7k w - d6 0 1")
+        exd6 = sisyphus.Move.parse_uci(board, "e5d6")
+        self.assertIn(exd6, board.gen_pseudo_legal_moves)
+        self.assertNotIn(exd6, board.gen_legal_moves)
+        self.assertNotIn(exd6, list(board.gen_legal_moves))
+
+        # A pinned knight may not move, the king may not capture a defended piece
+        board = sisyphus.Board("4r2k/8/8/8/8/8/4N3/4K3 w - - 0 1")
+        self.assertNotIn(sisyphus.Move.parse_uci(board, "e2c3"), board.gen_legal_moves)
+        self.assertIn(sisyphus.Move.parse_uci(board, "e1d1"), board.gen_legal_moves)
+        self.assertEqual(len(list(board.gen_legal_moves)), 4)
+
+        # Double check leaves only king moves
+        board = sisyphus.Board("4k3/8/5N2/1B6/8/8/8/6K1 b - - 0 1")
+        moves = list(board.gen_legal_moves)
+        self.assertTrue(moves)
+        king = sisyphus.PieceType(sisyphus.KING, sisyphus.BLACK)
+        self.assertTrue(all(move.piece == king for move in moves))
+
+        # A single check can be answered by blocking, capturing or en passant
+        board.set_fen("4k3/8/8/8/8/8/4r3/R3K3 w - - 0 1")
+        moves = [move.move_str() for move in board.gen_legal_moves]
+        self.assertEqual(sorted(moves), ["e1d1", "e1e2", "e1f1"])
+        board.set_fen("8/8/8/2k5/3Pp3/8/8/4K3 b - d3 0 1")
+        self.assertIn(sisyphus.Move.parse_uci(board, "e4d3"), board.gen_legal_moves)
+        self.assertIn("c5d4", [move.move_str() for move in board.gen_legal_moves])
+
     def test_attackers(self):
         board = sisyphus.Board(
             "r1b1k2r/pp1n1ppp/2p1p3/q5B1/1b1P4/P1n1PN2/1P1Q1PPP/2R1KB1R b Kkq - 3 10"
@@ -201,6 +259,118 @@ class BoardTestCase(unittest.TestCase):
         )
         self.assertTrue(board.is_check())
 
+    def test_check_after_move(self):
+        board = sisyphus.Board(
+            "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2"
+        )
+        self.assertFalse(board.is_check())
+        board.push(sisyphus.Move.parse_uci(board, "d1h5"))
+        self.assertFalse(board.is_check())
+        board.push(sisyphus.Move.parse_uci(board, "b8c6"))
+        board.push(sisyphus.Move.parse_uci(board, "h5f7"))
+        self.assertTrue(board.is_check())
+        board.pop()
+        self.assertFalse(board.is_check())
+        board.push(sisyphus.Move.parse_uci(board, "h5f7"))
+        self.assertTrue(board.is_check())
+
+    def test_gives_check(self):
+        # Position and a move of each kind that must give check, if any
+        cases = [
+            ("4k3/8/8/8/8/8/4N3/4R1K1 w - - 0 1", "e2c3"),   # Discovered check
+            ("8/8/8/k2pP2R/8/8/8/4K3 w - d6 0 1", "e5d6"),   # En passant discovery
+            ("8/1b6/8/8/3pP3/8/8/k6K b - e3 0 1", "d4e3"),   # Diagonal discovery
+            ("3k4/1P6/8/8/8/8/8/4K3 w - - 0 1", "b7b8q"),    # Promotion
+            ("2r1k3/1P6/8/8/8/8/8/4K3 w - - 0 1", "b7c8q"),  # Promotion capture
+            ("8/1P1k4/8/8/8/8/8/4K3 w - - 0 1", "b7b8n"),    # Knight promotion
+            ("5k2/8/8/8/8/8/8/4K2R w K - 0 1", "e1g1"),      # Castling rook
+            ("3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", "e1c1"),
+            ("r3k3/8/8/8/8/8/8/3K4 b q - 0 1", "e8c8"),
+            ("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", None),
+            ("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", "g2g3"),
+            ("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", None),
+        ]
+
+        for fen, expected in cases:
+            board = sisyphus.Board(fen)
+            checks = set()
+            for move in board.generate_pseudo_legal_moves():
+                gives = board.gives_check(move)
+                board.push(move)
+                self.assertEqual(gives, board.is_check(), f"{fen} {move}")
+                board.pop()
+                if gives:
+                    checks.add(move.san)
+            if expected:
+                self.assertIn(expected, checks, fen)
+
+    def test_move_picker(self):
+        def parse(board, *ucis):
+            return [sisyphus.Move.parse_uci(board, uci) for uci in ucis]
+
+        kiwipete = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"
+        # Position, table move, killers
+        cases = [
+            (sisyphus.STARTING_FEN, "e2e4", ("g1f3", "b1c3")),
+            (kiwipete, "e5f7", ("a2a3", "e1g1")),
+            (kiwipete, "d5e6", ("e5f7", "a6b5")),  # Capture and opponent move as killers
+            ("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", None, ()),
+        ]
+        for fen, tt, killers in cases:
+            board = sisyphus.Board(fen)
+            tt_move = parse(board, tt)[0] if tt else None
+            picked = list(board.generate_picked_moves(tt_move, tuple(parse(board, *killers))))
+            self.assertEqual(len(picked), len(set(picked)), fen)
+            self.assertEqual(set(picked), set(board.generate_pseudo_legal_moves()), fen)
+            if tt_move:
+                self.assertEqual(picked[0], tt_move)
+
+        # A table move from another position is never played
+        board = sisyphus.Board()
+        pawn = sisyphus.PieceType(sisyphus.PAWN, sisyphus.WHITE)
+        bogus = sisyphus.Move(sisyphus.E2, sisyphus.E5, pawn)
+        picked = list(board.generate_picked_moves(bogus, (bogus,)))
+        self.assertNotIn(bogus, picked)
+        self.assertEqual(set(picked), set(board.generate_pseudo_legal_moves()))
+
+        # In check only evasions are generated, every legal move once
+        board = sisyphus.Board(
+            "rnbqkbnr/ppp2ppp/3p4/1B2Q3/8/8/PPPPPPPP/RN2KBNR b KQkq - 0 1"
+        )
+        legal = set(board.generate_legal_moves())
+        pseudo = set(board.generate_pseudo_legal_moves())
+        for tt in ("c7c6", "a7a6", None):
+            tt_move = parse(board, tt)[0] if tt else None
+            picked = list(board.generate_picked_moves(tt_move, tuple(parse(board, "a7a6"))))
+            self.assertEqual(len(picked), len(set(picked)))
+            self.assertTrue(set(picked) <= pseudo)
+            self.assertEqual(set(picked) & legal, legal)
+            if tt_move in legal:
+                self.assertEqual(picked[0], tt_move)
+            else:
+                self.assertNotEqual(picked[0], tt_move)
+
+    def test_pawn_hash(self):
+        board = sisyphus.Board()
+        for uci in ["e2e4", "d7d5", "e4d5", "g8f6", "f1b5", "c7c6", "d5c6", "d8d2"]:
+            board.push(sisyphus.Move.parse_uci(board, uci))
+            fresh = sisyphus.Board(board.fen)
+            self.assertEqual(
+                board.board.baseboard.pawn_hash, fresh.board.baseboard.pawn_hash
+            )
+        pawn_hash = board.board.baseboard.pawn_hash
+        board.push(sisyphus.Move.parse_uci(board, "b1d2"))
+        self.assertEqual(board.board.baseboard.pawn_hash, pawn_hash)
+
+    def test_eval_symmetry(self):
+        board = sisyphus.Board(
+            "r1bqk2r/pp3ppp/2n1pn2/3p4/1bPP4/2N2N2/PP2PPPP/R2QKB1R w KQkq - 0 1"
+        )
+        mirror = sisyphus.Board(
+            "r2qkb1r/pp2pppp/2n2n2/1Bpp4/3P4/2N1PN2/PP3PPP/R1BQK2R b KQkq - 0 1"
+        )
+        self.assertEqual(board.eval(), mirror.eval())
+
     def test_checkers(self):
         board = sisyphus.Board(
             "rnbqkbnr/ppp2ppp/3p4/1B2Q3/8/8/PPPPPPPP/RN2KBNR b KQkq - 0 1"
@@ -343,6 +513,363 @@ class PiecTypeTestCase(unittest.TestCase):
         self.assertEqual(sisyphus.PieceType.from_symbol("Q"), piece)
 
 
+class SearcherTestCase(unittest.TestCase):
+    def test_concurrent_searchers(self):
+        fens = [
+            sisyphus.STARTING_FEN,
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        ]
+        results = {}
+
+        def run(fen):
+            board = sisyphus.Board(fen)
+            move = sisyphus.Searcher(board).start(time_s=0.3, threads=2)
+            results[fen] = (move, board.fen)
+
+        workers = [threading.Thread(target=run, args=(fen,)) for fen in fens]
+        for worker in workers:
+            worker.start()
+        for worker in workers:
+            worker.join()
+
+        for fen in fens:
+            move, after = results[fen]
+            self.assertIn(move, sisyphus.Board(fen).gen_legal_moves)
+            self.assertEqual(after, sisyphus.Board(fen).fen)
+
+    def test_early_completion(self):
+        board = sisyphus.Board("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1")
+        searcher = sisyphus.Searcher(board)
+
+        start = time.perf_counter()
+        searcher.go(time_s=10.0)
+        move = searcher.wait()
+        self.assertLess(time.perf_counter() - start, 5.0)
+        self.assertTrue(searcher.poll())
+        self.assertEqual(move.san, "a1a8")
+
+        move = asyncio.run(searcher.start_async(time_s=10.0))
+        self.assertEqual(move.san, "a1a8")
+
+    def test_time_manager(self):
+        searcher = sisyphus.Searcher(sisyphus.Board())
+
+        start = time.perf_counter()
+        move = searcher.start(time_s=60.0, wtime=1000, btime=1000)
+        self.assertLess(time.perf_counter() - start, 1.0)
+        self.assertIn(move, sisyphus.Board().gen_legal_moves)
+        self.assertLessEqual(searcher.search.tm.soft, searcher.search.tm.hard)
+
+        # Only the opponent's clock: time_s still limits the search
+        searcher.go(time_s=0.3, btime=1000)
+        deadline = time.perf_counter() + 2.0
+        while not searcher.poll() and time.perf_counter() < deadline:
+            time.sleep(0.05)
+        finished = searcher.poll()
+        searcher.stop()
+        self.assertTrue(finished)
+        self.assertIn(searcher.wait(), sisyphus.Board().gen_legal_moves)
+
+    def write_network(self, features):
+        # Small network with deterministic weights, HalfKP (0) or HalfKA (1)
+        hidden, inputs = 16, 64 * (10 + 2 * features) * 64
+        weights = [(i * 7919) % 81 - 40 for i in range(inputs * hidden)]
+        with tempfile.NamedTemporaryFile(suffix=".nnue", delete=False) as f:
+            f.write(b"SISNNUE1" + struct.pack("<II", features, hidden))
+            f.write(struct.pack(f"<{inputs * hidden}h", *weights))
+            f.write(struct.pack(f"<{hidden}h", *range(0, 8 * hidden, 8)))
+            f.write(struct.pack(f"<{2 * hidden}h", *[(i % 9) - 4 for i in range(2 * hidden)]))
+            f.write(struct.pack("<i", 100))
+        self.addCleanup(os.remove, f.name)
+        self.addCleanup(sisyphus.Searcher.use_network, False)
+        return f
+
+    def test_network(self):
+        f = self.write_network(0)
+
+        board = sisyphus.Board(
+            "r1bqk2r/pp3ppp/2n1pn2/3p4/1bPP4/2N2N2/PP2PPPP/R2QKB1R w KQkq - 0 1"
+        )
+        mirror = sisyphus.Board(
+            "r2qkb1r/pp2pppp/2n2n2/1Bpp4/3P4/2N1PN2/PP3PPP/R1BQK2R b KQkq - 0 1"
+        )
+        classic = board.eval()
+
+        self.assertFalse(sisyphus.Searcher.load_network(__file__))
+        self.assertTrue(sisyphus.Searcher.load_network(f.name))
+        self.assertTrue(sisyphus.Searcher.network_enabled())
+        self.assertEqual(board.eval(), mirror.eval())
+
+        searcher = sisyphus.Searcher(board)
+        move = searcher.start(depth=4, time_s=None)
+        self.assertIn(move, board.gen_legal_moves)
+
+        # The network is pinned while any search runs
+        searcher.go(time_s=10.0)
+        with self.assertRaises(RuntimeError):
+            sisyphus.Searcher.load_network(f.name)
+        with self.assertRaises(RuntimeError):
+            sisyphus.Searcher.use_network(False)
+        searcher.stop()
+        searcher.wait()
+
+        sisyphus.Searcher.use_network(False)
+        self.assertFalse(sisyphus.Searcher.network_enabled())
+        self.assertEqual(board.eval(), classic)
+
+    def test_network_switch(self):
+        def stored_evals(searcher):
+            table = searcher.search.table
+            return sum(
+                entry.eval != 0
+                for i in range(table.size)
+                for entry in table.bucket[i].entry
+            )
+
+        searcher = sisyphus.Searcher(sisyphus.Board())
+        searcher.set_hash(1)
+        searcher.start(depth=5, time_s=None)
+        pesto = stored_evals(searcher)
+        self.assertGreater(pesto, 100)
+
+        # PESTO evaluations must not be served to a network search
+        self.assertTrue(sisyphus.Searcher.load_network(self.write_network(0).name))
+        searcher.start(depth=1, time_s=None)
+        self.assertLess(stored_evals(searcher), 50)
+
+        searcher.start(depth=5, time_s=None)
+        version = searcher.search.table.eval_version
+        sisyphus.Searcher.use_network(False)
+        searcher.start(depth=1, time_s=None)
+        self.assertNotEqual(searcher.search.table.eval_version, version)
+        self.assertLess(stored_evals(searcher), 50)
+
+    def test_network_incremental(self):
+        fens = [
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+            "4k3/1P6/8/8/8/8/6p1/4K3 w - - 0 1",
+        ]
+        rng = random.Random(7)
+
+        for features in (0, 1):
+            self.assertTrue(sisyphus.Searcher.load_network(self.write_network(features).name))
+            king_moves = 0
+
+            for fen in fens:
+                board = sisyphus.Board(fen)
+                stack = sisyphus.chess_lib.nnue_stack_new()
+                self.assertTrue(stack)
+                board.board.baseboard.nnue = stack
+                expected = [board.eval()]
+
+                # Every make and unmake must match a refresh from scratch
+                for _ in range(40):
+                    moves = list(board.gen_legal_moves)
+                    if not moves:
+                        break
+                    move = rng.choice(moves)
+                    king_moves += move.piece.piece == sisyphus.KING
+                    board.push(move)
+                    expected.append(sisyphus.Board(board.fen).eval())
+                    self.assertEqual(board.eval(), expected[-1], f"{fen} {move}")
+
+                while len(expected) > 1:
+                    expected.pop()
+                    board.pop()
+                    self.assertEqual(board.eval(), expected[-1], fen)
+
+                board.board.baseboard.nnue = None
+                sisyphus.chess_lib.nnue_stack_free(stack)
+
+            # King moves refresh the accumulator of their own side
+            self.assertGreater(king_moves, 0)
+
+    def test_parameters(self):
+        fen = "r1bqk2r/pp3ppp/2n1pn2/3p4/1bPP4/2N2N2/PP2PPPP/R2QKB1R w KQkq - 0 1"
+        classic = sisyphus.Board(fen).eval()
+        early = sisyphus.Board(fen)
+        with tempfile.TemporaryDirectory() as tmp:
+            defaults = os.path.join(tmp, "defaults.txt")
+            partial = os.path.join(tmp, "partial.txt")
+            self.assertTrue(sisyphus.Searcher.save_parameters(defaults))
+            self.addCleanup(sisyphus.Searcher.load_parameters, defaults)
+
+            with open(partial, "w") as f:
+                f.write("# stronger bishops\nmg_value 82 337 465 477 1025 0\n")
+            self.assertTrue(sisyphus.Searcher.load_parameters(partial))
+            # White has given up a bishop on the board above
+            self.assertLess(sisyphus.Board(fen).eval(), classic)
+
+            # A board set up before the load keeps correct sums through moves
+            for uci in ("d1a4", "e8g8", "a4b4"):
+                early.push(sisyphus.Move.parse_uci(early, uci))
+                self.assertEqual(early.eval(), sisyphus.Board(early.fen).eval())
+
+            searcher = sisyphus.Searcher(sisyphus.Board(fen))
+            searcher.go(time_s=10.0)
+            with self.assertRaises(RuntimeError):
+                sisyphus.Searcher.load_parameters(defaults)
+            searcher.stop()
+            searcher.wait()
+
+            with open(partial, "w") as f:
+                f.write("mg_value 1 2 3\n")
+            self.assertFalse(sisyphus.Searcher.load_parameters(partial))
+
+            self.assertTrue(sisyphus.Searcher.load_parameters(defaults))
+            self.assertEqual(sisyphus.Board(fen).eval(), classic)
+
+    def test_persistent_table(self):
+        fen = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"
+        searcher = sisyphus.Searcher(sisyphus.Board(fen))
+        searcher.start(depth=5, time_s=None)
+        first = searcher.nodes
+
+        # The second search starts from the entries of the first
+        searcher.start(depth=5, time_s=None)
+        self.assertLess(searcher.nodes, first)
+
+        searcher.clear()
+        searcher.start(depth=5, time_s=None)
+        self.assertEqual(searcher.nodes, first)
+
+    def test_table_buckets(self):
+        # Five compact entries share one cache line
+        self.assertEqual(ctypes.sizeof(sisyphus.Entry), 12)
+        self.assertEqual(ctypes.sizeof(sisyphus.Bucket), 64)
+
+        searcher = sisyphus.Searcher(sisyphus.Board())
+        searcher.start(depth=6, time_s=None)
+        generation = searcher.search.table.generation
+        used = searcher.hashfull
+        self.assertGreater(used, 0)
+
+        # Entries of the previous search are aged out of hashfull
+        searcher.board = sisyphus.Board("4k3/8/8/8/8/8/8/4K2Q w - - 0 1")
+        searcher.start(depth=1, time_s=None)
+        self.assertNotEqual(searcher.search.table.generation, generation)
+        self.assertLess(searcher.hashfull, used)
+
+    def test_hash_size(self):
+        searcher = sisyphus.Searcher(sisyphus.Board())
+        for mb in (0, -1):
+            with self.assertRaises(ValueError):
+                searcher.set_hash(mb)
+
+        bucket = ctypes.sizeof(sisyphus.Bucket)
+        searcher.set_hash(1)
+        self.assertEqual(searcher.search.table.size, (1 << 20) // bucket)
+        self.assertEqual(searcher.hashfull, 0)
+        move = searcher.start(depth=5, time_s=None)
+        self.assertIn(move, sisyphus.Board().gen_legal_moves)
+        self.assertGreater(searcher.hashfull, 0)
+        self.assertLessEqual(searcher.hashfull, 1000)
+
+        searcher.clear()
+        self.assertEqual(searcher.hashfull, 0)
+
+        searcher.set_hash(4)
+        self.assertEqual(searcher.search.table.size, (4 << 20) // bucket)
+        self.assertEqual(searcher.hashfull, 0)
+
+    def test_eval_cache(self):
+        searcher = sisyphus.Searcher(sisyphus.Board())
+        searcher.start(depth=5, time_s=None)
+        self.assertGreater(searcher.search.eval_probes, 0)
+        first = searcher.eval_hit_rate
+        self.assertGreater(first, 0.0)
+        self.assertLessEqual(first, 1.0)
+
+        # The table keeps the evaluations of the first search
+        searcher.start(depth=5, time_s=None)
+        self.assertGreater(searcher.eval_hit_rate, first)
+
+        searcher.clear()
+        self.assertEqual(searcher.search.eval_probes, 0)
+        self.assertEqual(searcher.eval_hit_rate, 0.0)
+        searcher.start(depth=5, time_s=None)
+        self.assertAlmostEqual(searcher.eval_hit_rate, first)
+
+    def test_limits(self):
+        searcher = sisyphus.Searcher(sisyphus.Board())
+        searcher.start(depth=4, time_s=None)
+        self.assertEqual(searcher.depth, 4)
+
+        moves = [
+            sisyphus.Searcher(sisyphus.Board()).start(nodes=10000, time_s=None)
+            for _ in range(2)
+        ]
+        self.assertEqual(moves[0], moves[1])
+
+        with self.assertRaises(ValueError):
+            searcher.start(depth=0)
+
+    def test_info_callback(self):
+        board = sisyphus.Board()
+        searcher = sisyphus.Searcher(board)
+        infos = []
+        searcher.set_info_callback(infos.append)
+        move = searcher.start(depth=5, time_s=None)
+
+        self.assertEqual([info.depth for info in infos], [1, 2, 3, 4, 5])
+        self.assertEqual(infos[-1].pv[0], move)
+        self.assertGreater(infos[-1].nodes, infos[0].nodes)
+
+        # Current move reports carry the depth of the iteration in progress
+        infos.clear()
+        searcher.set_info_callback(infos.append, interval_ms=1)
+        searcher.start(depth=7, time_s=None)
+        current = [info for info in infos if info.currmove is not None]
+        completed = [info.depth for info in infos if info.currmove is None]
+        self.assertTrue(current)
+        self.assertEqual(completed, [1, 2, 3, 4, 5, 6, 7])
+        for info in current:
+            self.assertIn(info.depth, range(1, 8))
+            self.assertIn(info.currmove, board.gen_legal_moves)
+            self.assertFalse(info.pv)
+
+    def test_ponder(self):
+        searcher = sisyphus.Searcher(sisyphus.Board())
+        searcher.go(ponder=True, wtime=300, btime=300)
+        time.sleep(0.3)
+        self.assertFalse(searcher.poll())
+
+        searcher.ponderhit()
+        start = time.perf_counter()
+        move = searcher.wait()
+        self.assertLess(time.perf_counter() - start, 1.0)
+        self.assertIn(move, sisyphus.Board().gen_legal_moves)
+
+    def test_multipv(self):
+        board = sisyphus.Board()
+        searcher = sisyphus.Searcher(board)
+        searcher.multipv = 3
+        move = searcher.start(depth=4, time_s=None)
+
+        lines = searcher.lines
+        self.assertEqual(len(lines), 3)
+        self.assertEqual(lines[0].move, move)
+        self.assertEqual(len({line.move.san for line in lines}), 3)
+        self.assertEqual(lines, sorted(lines, key=lambda line: -line.score))
+
+        allowed = [sisyphus.Move.parse_uci(board, "a2a3"), sisyphus.Move.parse_uci(board, "h2h3")]
+        searcher.start(depth=4, time_s=None, searchmoves=allowed)
+        self.assertEqual({line.move.san for line in searcher.lines}, {"a2a3", "h2h3"})
+
+    def test_pv(self):
+        searcher = sisyphus.Searcher(sisyphus.Board())
+        move = searcher.start(depth=6, time_s=None)
+        pv = searcher.lines[0].pv
+        self.assertEqual(pv[0], move)
+        self.assertGreaterEqual(len(pv), 5)
+
+        board = sisyphus.Board()
+        for pv_move in pv:
+            self.assertIn(pv_move, board.gen_legal_moves)
+            board.push(pv_move)
+
+
 if __name__ == "__main__":
     verbosity = sum(
         arg.count("v") for arg in sys.argv if all(c == "v" for c in arg.lstrip("-"))
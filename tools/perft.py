@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""Perft verification and move generator benchmark.
+
+Without arguments runs the standard perft positions (startpos, Kiwipete and
+positions 3-6), checks every node count against the published value and
+prints nodes/sec, optionally split over threads sharing a hash of the given
+size in MB. With a FEN and a depth prints the divide of that position, one
+line per legal root move, for comparison against a reference engine.
+
+Usage: python3 tools/perft.py [threads] [hash_mb]
+       python3 tools/perft.py "<fen>" <depth>
+"""
+from __future__ import annotations
+
+import sys
+import time
+from typing import List, Tuple
+
+from sisyphus import PERFT_HASH_MB, Board
+
+# (name, fen, depth, expected nodes)
+POSITIONS: List[Tuple[str, str, int, int]] = [
+    ("startpos", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 6, 119060324),
+    ("kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5, 193690690),
+    ("position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 7, 178633661),
+    ("position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292),
+    ("position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 5, 89941194),
+    ("position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 5, 164075551),
+]
+
+
+def divide(fen: str, depth: int) -> None:
+    board = Board(fen)
+    total = 0
+    for move, nodes in sorted(board.perft_divide(depth).items(), key=lambda item: item[0].move_str()):
+        print(f"{move.move_str()}: {nodes}")
+        total += nodes
+    print(f"\nnodes {total}")
+
+
+def bench(threads: int, hash_mb: int) -> bool:
+    print(f"{threads} threads, {hash_mb} MB hash")
+    print(f"{'position':<12} {'depth':>5} {'nodes':>12} {'seconds':>8} {'nps':>12}")
+
+    ok = True
+    total_nodes, total_time = 0, 0.0
+    for name, fen, depth, expected in POSITIONS:
+        board = Board(fen)
+        start = time.perf_counter()
+        nodes = board.perft_test(depth, threads, hash_mb)
+        elapsed = time.perf_counter() - start
+
+        status = "" if nodes == expected else f"  FAIL expected {expected}"
+        ok = ok and nodes == expected
+        total_nodes += nodes
+        total_time += elapsed
+        print(f"{name:<12} {depth:>5} {nodes:>12} {elapsed:>8.3f} {nodes / elapsed:>12.0f}{status}")
+
+    print(f"{'total':<12} {'':>5} {total_nodes:>12} {total_time:>8.3f} {total_nodes / total_time:>12.0f}")
+    return ok
+
+
+def main() -> None:
+    if len(sys.argv) == 3 and "/" in sys.argv[1]:
+        divide(sys.argv[1], int(sys.argv[2]))
+        return
+
+    threads = int(sys.argv[1]) if len(sys.argv) > 1 else 1
+    hash_mb = int(sys.argv[2]) if len(sys.argv) > 2 else PERFT_HASH_MB
+    sys.exit(0 if bench(threads, hash_mb) else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+"""Lazy SMP scaling report.
+
+Measures the time a depth limited search needs to complete a target depth
+for 1/2/4/8/16 threads over a small set of positions, and prints the speedup
+relative to the single threaded run.
+
+Usage: python3 tools/smp_scaling.py [depth] [max_time_s]
+"""
+from __future__ import annotations
+
+import sys
+import time
+from typing import List, Optional
+
+from sisyphus import Board, Searcher
+
+POSITIONS: List[str] = [
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+]
+
+THREADS: List[int] = [1, 2, 4, 8, 16]
+
+
+def time_to_depth(fen: str, threads: int, depth: int, max_time: float) -> Optional[float]:
+    """Return the seconds needed to complete `depth`, or None if not reached."""
+    searcher = Searcher(Board(fen))
+
+    start = time.perf_counter()
+    searcher.start(depth=depth, time_s=max_time, threads=threads)
+    elapsed = time.perf_counter() - start
+
+    return elapsed if searcher.depth >= depth else None
+
+
+def main() -> None:
+    depth = int(sys.argv[1]) if len(sys.argv) > 1 else 8
+    max_time = float(sys.argv[2]) if len(sys.argv) > 2 else 10.0
+
+    print(f"time-to-depth {depth} (limit {max_time:.0f}s)")
+    print(f"{'threads':>8} {'total s':>10} {'speedup':>8}")
+
+    baseline: Optional[float] = None
+    for threads in THREADS:
+        total = 0.0
+        for fen in POSITIONS:
+            elapsed = time_to_depth(fen, threads, depth, max_time)
+            total += elapsed if elapsed is not None else max_time
+
+        if baseline is None:
+            baseline = total
+        print(f"{threads:>8} {total:>10.3f} {baseline / total:>8.2f}")
+
+
+if __name__ == "__main__":
+    main()
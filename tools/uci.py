@@ -2,9 +2,13 @@
 from __future__ import annotations
 
 import sys
-from typing import List, Dict, Any
+import threading
+from typing import List, Dict, Any, Optional
 import sisyphus
-from sisyphus import Board, Move, Searcher
+from sisyphus import Board, Info, Move, Searcher
+
+GO_KEYWORDS = {"searchmoves", "ponder", "wtime", "btime", "winc", "binc", "movestogo",
+               "depth", "nodes", "mate", "movetime", "infinite"}
 
 class UCI:
     """UCI protocol implementation for chess engine."""
@@ -12,8 +16,12 @@ class UCI:
     def __init__(self):
         self.board = Board()
         self.searcher = Searcher(self.board)
+        self.searcher.set_info_callback(self._info)
         self.count    = 0
         self.debug    = False
+        self.pv: List[Move] = []
+        self.waiter: Optional[threading.Thread] = None
+        self.release = threading.Event()  # Set once bestmove may be sent
 
     def print_banner(self) -> None:
         """Print engine banner with name and version."""
@@ -28,6 +36,26 @@ class UCI:
         print(f"\t\t\t\t\t\tAuthor: {sisyphus.__author__}")
         print(f"\t\t\t\t\t\tVersion: {sisyphus.__version__}\n")
 
+    def _info(self, info: Info) -> None:
+        """Print search progress as UCI info lines."""
+        if info.currmove is not None:
+            print(f"info depth {info.depth} currmove {info.currmove.move_str()} "
+                  f"currmovenumber {info.currmovenumber}", flush=True)
+            return
+
+        if abs(info.score) >= sisyphus.MATE - sisyphus.MAX_PLY:
+            plies = sisyphus.MATE - abs(info.score)
+            score = f"mate {(plies + 1) // 2 if info.score > 0 else -(plies // 2)}"
+        else:
+            score = f"cp {info.score}"
+
+        if info.multipv == 1:
+            self.pv = info.pv
+        pv = " ".join(move.move_str() for move in info.pv)
+        print(f"info depth {info.depth} seldepth {info.seldepth} multipv {info.multipv} score {score} "
+              f"nodes {info.nodes} nps {info.nps} time {info.time_ms} "
+              f"hashfull {info.hashfull} pv {pv}", flush=True)
+
     def _position(self, args: List[str]) -> None:
         """Handle 'position' command."""
         if not args:
@@ -46,6 +74,23 @@ class UCI:
                 self.board.push(Move.parse_uci(self.board, move))
                 self.count += 1
                 
+    def _setoption(self, args: List[str]) -> None:
+        """Handle 'setoption name <id> [value <x>]' command."""
+        if "name" not in args:
+            return
+
+        i = args.index("name")
+        j = args.index("value") if "value" in args else len(args)
+        name = " ".join(args[i + 1:j]).lower()
+        value = " ".join(args[j + 1:])
+
+        if name == "hash":
+            self.searcher.set_hash(int(value))
+        elif name == "move overhead":
+            self.searcher.move_overhead = int(value)
+        elif name == "multipv":
+            self.searcher.multipv = int(value)
+
     def _go(self, args: List[str]) -> None:
         """Handle 'go' command."""
         params: Dict[str, Any] = {}
@@ -54,45 +99,61 @@ class UCI:
         while i < len(args):
             param = args[i]
             
-            if param in ["depth", "movetime", "movestogo", "wtime", "winc", "binc", "btime"]:
+            if param in ["depth", "nodes", "mate", "movetime", "movestogo", "wtime", "winc", "binc", "btime"]:
                 i += 1
                 if i < len(args):
                     params[param] = int(args[i])
             elif param in ["infinite", "ponder"]:
                 params[param] = True
+            elif param == "searchmoves":
+                # Every move up to the next keyword
+                params[param] = []
+                while i + 1 < len(args) and args[i + 1] not in GO_KEYWORDS:
+                    i += 1
+                    params[param].append(Move.parse_uci(self.board, args[i]))
                 
             i += 1
 
-        # Start search with parameters
+        # Start search with parameters, the engine stops at the first limit
+        limits = {k: params[k] for k in ("depth", "nodes", "mate", "wtime", "btime", "winc", "binc", "movestogo", "searchmoves") if k in params}
+
         if "movetime" in params:
-            movetime = params["movetime"] / 1000
-            best_move = self.searcher.start(time_s=movetime)
-        
-        elif "wtime" in params:
-            wtime = params.get("wtime", 0) / 1000
-            btime = params.get("btime", 0) / 1000
-            winc  = params.get("winc", 0) / 1000
-            binc  = params.get("binc", 0) / 1000
+            limits["time_s"] = params["movetime"] / 1000
+        elif limits or "infinite" in params or "ponder" in params:
+            limits["time_s"] = None
 
-            if not self.board.turn:  
-                time, inc = wtime, winc
-            else:                
-                time, inc = btime, binc
+        # A bestmove must not be sent while pondering or in infinite mode,
+        # even if the search ends on its own
+        self.release.clear()
+        if "ponder" not in params and "infinite" not in params:
+            self.release.set()
 
-            think = min(time / 40 + inc, time / 2 - 1)
-            if self.count < 3:
-                think = min(think, 1.0)
+        self.pv = []
+        self.searcher.go(ponder="ponder" in params, **limits)
+        self.waiter = threading.Thread(target=self._bestmove, daemon=True)
+        self.waiter.start()
+        self.count = 0
 
-            best_move = self.searcher.start(time_s=think)
+    def _bestmove(self) -> None:
+        """Wait for the search in the background and send bestmove."""
+        best_move = self.searcher.wait()
+        self.release.wait()
 
-        elif "depth" in params:
-            best_move = self.searcher.start(depth=params["depth"])
+        if len(self.pv) > 1 and self.pv[0] == best_move:
+            print(f"bestmove {best_move.move_str()} ponder {self.pv[1].move_str()}", flush=True)
         else:
-            best_move = self.searcher.start()
-        
-        self.count = 0
-        print(f"bestmove {best_move.move_str()}")
-        
+            print(f"bestmove {best_move.move_str()}", flush=True)
+
+    def _stop(self) -> None:
+        """Stop the running search and wait until bestmove was sent."""
+        if self.waiter is None:
+            return
+
+        self.searcher.stop()
+        self.release.set()
+        self.waiter.join()
+        self.waiter = None
+
     def loop(self) -> None:
         """Main UCI command loop."""
         
@@ -109,27 +170,43 @@ class UCI:
                 cmd, args = tokens[0], tokens[1:]
                 
                 if cmd == "quit":
+                    self._stop()
                     break
                     
                 elif cmd == "stop":
-                    self.searcher.stop()
+                    self._stop()
+
+                elif cmd == "ponderhit":
+                    self.searcher.ponderhit()
+                    self.release.set()
                     
                 elif cmd == "uci":
                     print("id name Sisyphus")
                     print(f"id author {sisyphus.__author__}")
+                    print("option name Hash type spin default 16 min 1 max 65536")
+                    print("option name Ponder type check default false")
+                    print(f"option name MultiPV type spin default 1 min 1 max {sisyphus.MAX_MULTIPV}")
+                    print(f"option name Move Overhead type spin default {sisyphus.DEFAULT_MOVE_OVERHEAD} min 0 max 5000")
                     print("uciok")
                     
                 elif cmd == "isready":
                     print("readyok")
                     
                 elif cmd == "ucinewgame":
+                    self._stop()
                     self.board.clear()
                     self.searcher.clear()
                     
+                elif cmd == "setoption":
+                    self._stop()
+                    self._setoption(args)
+
                 elif cmd == "position":
+                    self._stop()
                     self._position(args)
                     
                 elif cmd == "go":
+                    self._stop()
                     self._go(args)
                     
                 elif cmd == "debug":